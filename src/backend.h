@@ -0,0 +1,82 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Selection of the storage policy of the samplers at load time.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+#ifndef BACKEND
+#define BACKEND
+
+#include <string>
+#include "scm/scm.h"
+
+/// Largest number of vertices handled by the fixed-width bitsets.
+static const unsigned int MAX_BITSET_WIDTH = 4096;
+/// Largest number of vertices for which "auto" picks bitsets. On random
+/// complexes with facets of 3 to 8 vertices and F = 2N (backend_benchmark
+/// --random N), bitsets validate and move faster than adjacency and stub
+/// lists up to N = 2048, and validate 1.4-1.5x slower than adjacency lists at
+/// N = 4096. Stub lists shuffle about 1.5x faster at all sizes.
+static const unsigned int AUTO_BITSET_MAX_VERTICES = 2048;
+
+/// Bytes taken by the bitsets of F facets on N vertices.
+inline unsigned long long bitset_bytes(unsigned int N, unsigned int F)
+{
+  unsigned long long width = 64;
+  while (width < N && width < MAX_BITSET_WIDTH) width *= 2;
+  if (width < N) width = ((N + 63ULL) / 64) * 64;  // dynamic bitsets
+  return (unsigned long long) F * width / 8;
+}
+
+/// Approximate bytes taken by the state of the adjacency backend: one
+/// tree node per incidence in the neighborhoods of both its facet and its
+/// vertex, plus one neighborhood per facet and per vertex.
+inline unsigned long long adjacency_backend_bytes(unsigned int N, unsigned int F, unsigned long long M)
+{
+  return 80 * M + sizeof(neighborhood_t) * ((unsigned long long) F + N);
+}
+
+/// Approximate bytes taken by the state of the bitset backend: the bitsets,
+/// three stubs per incidence (vertex and facet of each stub, and the
+/// per-vertex facet lists) and a few counters per facet and per vertex.
+/// Adjacency lists are only built transiently, for output.
+inline unsigned long long bitset_backend_bytes(unsigned int N, unsigned int F, unsigned long long M)
+{
+  return bitset_bytes(N, F) + sizeof(id_t) * (3 * M + 2 * (unsigned long long) F + 4 * N);
+}
+
+/** Resolve "auto" to a concrete backend, for a complex of F facets and
+  * M incidences on N vertices. auto picks the dense "bitset" representation
+  * for complexes on at most AUTO_BITSET_MAX_VERTICES vertices whose state
+  * takes no more memory than with adjacency lists, and "adjacency"
+  * otherwise. Returns an empty string for unknown backends.
+  */
+inline std::string resolve_backend(const std::string & backend, unsigned int N, unsigned int F, unsigned long long M)
+{
+  if (backend == "auto")
+  {
+    bool dense = N <= AUTO_BITSET_MAX_VERTICES &&
+                 bitset_backend_bytes(N, F, M) <= adjacency_backend_bytes(N, F, M);
+    return dense ? "bitset" : "adjacency";
+  }
+  if (backend == "adjacency" || backend == "stub" || backend == "bitset") return backend;
+  return std::string();
+}
+
+/** Call runner.run<complex_t>() with the complex type of a (resolved)
+  * backend. Bitsets get the smallest width that fits N vertices, and
+  * a dynamic width beyond MAX_BITSET_WIDTH.
+  */
+template <class runner_t>
+int run_with_backend(const std::string & backend, unsigned int N, runner_t & runner)
+{
+  if (backend == "adjacency") return runner.template run<scm_t>();
+  if (backend == "stub") return runner.template run<scm_stub_t>();
+  if (N <= 64) return runner.template run< scm_bitset_t<64> >();
+  if (N <= 128) return runner.template run< scm_bitset_t<128> >();
+  if (N <= 256) return runner.template run< scm_bitset_t<256> >();
+  if (N <= 512) return runner.template run< scm_bitset_t<512> >();
+  if (N <= 1024) return runner.template run< scm_bitset_t<1024> >();
+  if (N <= 2048) return runner.template run< scm_bitset_t<2048> >();
+  if (N <= 4096) return runner.template run< scm_bitset_t<4096> >();
+  return runner.template run<scm_dynamic_bitset_t>();
+}
+
+#endif // BACKEND
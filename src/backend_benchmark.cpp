@@ -0,0 +1,195 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Benchmark of the storage policies of the simplicial configuration model
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// STL
+#include <cstdlib>   // EXIT_FAILURE, EXIT_SUCCESS
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>  // max
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+// Boost
+#include <boost/program_options.hpp>
+// Program headers
+#include "types.h"
+#include "scm/scm.h"
+#include "io_functions.h"
+#include "backend.h"
+
+namespace po = boost::program_options;
+
+/// Average time of an operation, in microseconds.
+double time_op(unsigned int repetitions, std::function<void()> op)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (unsigned int r = 0; r < repetitions; ++r) op();
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / repetitions;
+}
+
+/// Random complex on N >= 8 vertices: 2N facets of 3 to 8 distinct vertices
+/// drawn uniformly, without included facets. Vertices are relabeled in
+/// order of appearance, such that unused ids leave no gaps.
+adj_list_t random_facet_list(unsigned int N, std::mt19937 & engine)
+{
+  std::uniform_int_distribution<unsigned int> random_size(3, 8);
+  std::vector<id_t> vertices(N);
+  for (id_t v = 0; v < N; ++v) vertices[v] = v;
+  adj_list_t facets(2 * N);
+  for (neighborhood_t & f : facets)
+  {
+    unsigned int k = random_size(engine);
+    // partial Fisher-Yates shuffle
+    for (unsigned int i = 0; i < k; ++i)
+    {
+      std::uniform_int_distribution<unsigned int> pick(i, N - 1);
+      std::swap(vertices[i], vertices[pick(engine)]);
+    }
+    f.insert(vertices.begin(), vertices.begin() + k);
+  }
+  prune_facet_list(facets);
+  std::vector<id_t> new_id(N, N);
+  id_t next_id = 0;
+  for (neighborhood_t & f : facets)
+  {
+    neighborhood_t relabeled;
+    for (id_t v : f)
+    {
+      if (new_id[v] == N) new_id[v] = next_id++;
+      relabeled.insert(new_id[v]);
+    }
+    f.swap(relabeled);
+  }
+  return facets;
+}
+
+template <class complex_t>
+void benchmark(const std::string & name, const adj_list_t & maximal_facets,
+               unsigned int repetitions, unsigned int l, unsigned int seed)
+{
+  std::mt19937 engine(seed);
+  std::vector<double> timings;
+  // construction
+  timings.push_back(time_op(repetitions, [&]() {complex_t K(maximal_facets);}));
+  // operations on a valid state
+  {
+    complex_t K(maximal_facets);
+    timings.push_back(time_op(repetitions, [&]() {K.is_simplicial_complex();}));
+    timings.push_back(time_op(repetitions, [&]() {
+      auto moves = K.random_rewire(l, engine);
+      K.do_moves(moves);
+    }));
+  }
+  // operations on random matchings
+  {
+    complex_t K(maximal_facets);
+    timings.push_back(time_op(repetitions, [&]() {K.shuffle(engine);}));
+    timings.push_back(time_op(repetitions, [&]() {K.shuffle(engine); K.has_multiedges();}));
+    timings.push_back(time_op(repetitions, [&]() {K.shuffle(engine); K.is_simplicial_complex();}));
+  }
+  std::cout << std::left << std::setw(12) << name;
+  for (double t : timings) std::cout << std::right << std::setw(14) << std::fixed << std::setprecision(2) << t;
+  std::cout << "\n";
+}
+
+/// Runs the benchmark with the complex type chosen by run_with_backend().
+struct benchmark_runner_t
+{
+  std::string name;
+  const adj_list_t & maximal_facets;
+  unsigned int repetitions;
+  unsigned int l;
+  unsigned int seed;
+  template <class complex_t>
+  int run()
+  {
+    benchmark<complex_t>(name, maximal_facets, repetitions, l, seed);
+    return 0;
+  }
+};
+
+int main(int argc, char const *argv[])
+{
+  /* ~~~~~ Program options ~~~~~~~*/
+  std::string facet_list_path;
+  unsigned int repetitions = 1000;
+  unsigned int l = 2;
+  unsigned int seed = 42;
+  unsigned int random_N = 0;
+  po::options_description description("Options");
+  description.add_options()
+  ("repetitions,r", po::value<unsigned int>(&repetitions),
+      "Number of repetitions of each operation. Defaults to 1000.")
+  ("l,l", po::value<unsigned int>(&l),
+      "Number of rewired incidences in MCMC moves. Defaults to 2.")
+  ("seed,d", po::value<unsigned int>(&seed),
+      "Seed of the pseudo random number generator. Defaults to 42.")
+  ("random", po::value<unsigned int>(&random_N),
+      "Benchmark a random complex on this many vertices instead of a facet list: 2N facets of 3 to 8 vertices drawn uniformly, without included facets. At least 8.")
+  ("cleansed_input,c", "Assume that the input is already cleansed, i.e., that nodes are labeled with 0 indexed contiguous integers and that no facet is included in another.")
+  ("help,h", "Produce this help message.")
+  ;
+  po::options_description hidden;
+  hidden.add_options()
+  ("facet_list_path", po::value<std::string>(&facet_list_path),
+      "Path to facet list.")
+  ;
+  po::positional_options_description p;
+  p.add("facet_list_path", -1);
+  po::options_description all_options;
+  all_options.add(description);
+  all_options.add(hidden);
+  po::variables_map var_map;
+  po::store(po::command_line_parser(argc, argv).
+          options(all_options).
+          positional(p).
+          run(),
+          var_map);
+  po::notify(var_map);
+  if (var_map.count("help") || argc == 1)
+  {
+      std::cout << "Usage:\n"
+                << "  "+std::string(argv[0])+" [--option_1=VAL] ... [--option_n=VAL] path-to-facet-list\n"
+                << "  "+std::string(argv[0])+" [--option_1=VAL] ... [--option_n=VAL] --random N\n";
+      std::cout << description;
+      return EXIT_SUCCESS;
+  }
+  adj_list_t maximal_facets;
+  if (var_map.count("random"))
+  {
+    if (random_N < 8)
+    {
+      std::cerr << "Random complexes need at least 8 vertices.\n";
+      return EXIT_FAILURE;
+    }
+    std::mt19937 engine(seed);
+    maximal_facets = random_facet_list(random_N, engine);
+  }
+  else
+  {
+    vmap_t id_to_vertex;
+    std::ifstream file(facet_list_path.c_str());
+    if (!file.is_open()) return EXIT_FAILURE;
+    read_facet_list(maximal_facets, file, var_map.count("cleansed_input") != 0, id_to_vertex);
+    file.close();
+  }
+
+  std::cout << "# Average time per operation (microseconds)\n";
+  std::cout << std::left << std::setw(12) << "# backend";
+  for (std::string op : {"construct", "validate", "mcmc_move", "shuffle", "shuf+multi", "rejection"})
+    std::cout << std::right << std::setw(14) << op;
+  std::cout << "\n";
+  unsigned int N = 0;
+  for (auto & f : maximal_facets)
+    if (!f.empty()) N = std::max(N, *f.rbegin() + 1);
+  for (std::string backend : {"adjacency", "stub", "bitset"})
+  {
+    benchmark_runner_t runner{backend, maximal_facets, repetitions, l, seed};
+    run_with_backend(backend, N, runner);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,341 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Convert bipartite graphs (KONECT format) to cleansed maximal facet lists
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// STL
+#include <cstdlib>   // EXIT_FAILURE, EXIT_SUCCESS, strtoull
+#include <cstdint>
+#include <cstdio>    // remove
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <functional>  // greater
+#include <memory>  // unique_ptr
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>  // getpid
+// Boost
+#include <boost/program_options.hpp>
+// Program headers
+#include "types.h"
+#include "io_functions.h"
+
+namespace po = boost::program_options;
+
+// Edges are stored as (facet << 32) | vertex, such that sorting the keys
+// groups the edges by facet.
+typedef std::uint64_t edge_key_t;
+
+// Largest number of runs merged at once, well below the usual limits on
+// open files. More runs are merged in several passes.
+const unsigned int MAX_MERGE_FAN_IN = 64;
+
+
+/// Sequential reader of a sorted run of edge keys, with a bounded buffer.
+class run_reader_t {
+public:
+  run_reader_t(const std::string & path, std::size_t buffer_size)
+    : file_(path.c_str(), std::ios::binary), buffer_(std::max<std::size_t>(buffer_size, 1)), pos_(0), end_(0)
+  {
+    refill();
+  }
+  bool is_open() const {return file_.is_open();}
+  bool empty() const {return pos_ == end_;}
+  edge_key_t front() const {return buffer_[pos_];}
+  void pop()
+  {
+    if (++pos_ == end_) refill();
+  }
+private:
+  std::ifstream file_;
+  std::vector<edge_key_t> buffer_;
+  std::size_t pos_;
+  std::size_t end_;
+  void refill()
+  {
+    file_.read(reinterpret_cast<char *>(buffer_.data()), buffer_.size() * sizeof(edge_key_t));
+    pos_ = 0;
+    end_ = file_.gcount() / sizeof(edge_key_t);
+  }
+};
+
+/// Sort and deduplicate a chunk of edges, and write it as a run.
+bool write_run(std::vector<edge_key_t> & edges, const std::string & path)
+{
+  std::sort(edges.begin(), edges.end());
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  std::ofstream run(path.c_str(), std::ios::binary);
+  if (!run.is_open()) return false;
+  run.write(reinterpret_cast<const char *>(edges.data()), edges.size() * sizeof(edge_key_t));
+  edges.clear();
+  return (bool) run;
+}
+
+/// Remove the files of runs.
+void remove_runs(const std::vector<std::string> & paths)
+{
+  for (const std::string & run : paths) std::remove(run.c_str());
+}
+
+/// Sort and deduplicate vertex ids.
+void compact_ids(std::vector<id_t> & ids)
+{
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+/// Merge sorted runs, calling sink(e) on each distinct edge key in increasing
+/// order. The buffers of the runs share buffer_size keys. Returns false if a
+/// run cannot be opened.
+template <typename sink_t>
+bool merge_runs(const std::vector<std::string> & paths, std::size_t buffer_size, sink_t sink)
+{
+  std::vector< std::unique_ptr<run_reader_t> > readers;
+  typedef std::pair<edge_key_t, unsigned int> head_t;
+  std::priority_queue<head_t, std::vector<head_t>, std::greater<head_t> > heads;
+  for (unsigned int r = 0; r < paths.size(); ++r)
+  {
+    readers.emplace_back(new run_reader_t(paths[r], buffer_size / paths.size()));
+    if (!readers[r]->is_open())
+    {
+      std::cerr << "Cannot open run " << paths[r] << "\n";
+      return false;
+    }
+    if (!readers[r]->empty()) heads.push(head_t(readers[r]->front(), r));
+  }
+  edge_key_t last_edge = ~(edge_key_t) 0;
+  while (!heads.empty())
+  {
+    head_t head = heads.top();
+    heads.pop();
+    if (head.first != last_edge) sink(head.first);  // repeated across runs
+    last_edge = head.first;
+    readers[head.second]->pop();
+    if (!readers[head.second]->empty()) heads.push(head_t(readers[head.second]->front(), head.second));
+  }
+  return true;
+}
+
+int main(int argc, char const *argv[])
+{
+  /* ~~~~~ Program options ~~~~~~~*/
+  std::string edge_list_path;
+  std::string output_path;
+  std::string tmp_dir = ".";
+  unsigned int col = 0;
+  unsigned int memory_limit = 1024;
+  po::options_description description("Options");
+  description.add_options()
+  ("col,c", po::value<unsigned int>(&col),
+      "Column to use as facets (0 or 1). Defaults to 0.")
+  ("output,o", po::value<std::string>(&output_path),
+      "Path of the facet list. Defaults to the standard output.")
+  ("memory_limit,m", po::value<unsigned int>(&memory_limit),
+      "Memory used to sort edges, in MB. Larger inputs are sorted in runs stored in tmp_dir. Defaults to 1024.")
+  ("tmp_dir", po::value<std::string>(&tmp_dir),
+      "Directory of the temporary runs. Defaults to the working directory.")
+  ("verbose,v", "Output log messages.")
+  ("help,h", "Produce this help message.")
+  ;
+  po::options_description hidden;
+  hidden.add_options()
+  ("edge_list_path", po::value<std::string>(&edge_list_path),
+      "Path to edge list.")
+  ;
+  po::positional_options_description p;
+  p.add("edge_list_path", -1);
+  po::options_description all_options;
+  all_options.add(description);
+  all_options.add(hidden);
+  po::variables_map var_map;
+  po::store(po::command_line_parser(argc, argv).
+          options(all_options).
+          positional(p).
+          run(),
+          var_map);
+  po::notify(var_map);
+  if (var_map.count("help") || argc == 1)
+  {
+      std::cout << "Usage:\n"
+                << "  "+std::string(argv[0])+" [--option_1=VAL] ... [--option_n=VAL] path-to-edge-list\n";
+      std::cout << description;
+      return EXIT_SUCCESS;
+  }
+  if (col > 1)
+  {
+      std::cerr << "The facet column must be 0 or 1.\n";
+      return EXIT_FAILURE;
+  }
+  bool verbose = var_map.count("verbose") != 0;
+
+
+  /* ~~~~~ Read edges in sorted runs ~~~~~~~*/
+  std::ifstream file(edge_list_path.c_str());
+  if (!file.is_open())
+  {
+      std::cerr << "Cannot open edge list " << edge_list_path << "\n";
+      return EXIT_FAILURE;
+  }
+  std::size_t capacity = std::max<std::size_t>((std::size_t) memory_limit * (1 << 20) / sizeof(edge_key_t), 1);
+  std::vector<edge_key_t> edges;
+  edges.reserve(std::min<std::size_t>(capacity, 1 << 20));
+  std::vector<std::string> runs;
+  unsigned int num_runs = 0;  // including merged runs
+  auto new_run_path = [&]() {
+    return tmp_dir + "/bipartite_run_" + std::to_string(getpid()) + "_" + std::to_string(num_runs++);
+  };
+  // Original vertex ids in use, compacted whenever their number doubles,
+  // such that sparse ids (e.g., close to 2^32) take no more memory than
+  // dense ones.
+  std::vector<id_t> vertex_ids;
+  std::size_t compact_at = 1 << 16;
+  std::string line_buffer;
+  unsigned long long num_lines = 0;
+  while (getline(file, line_buffer))
+  {
+    // KONECT: '%' comments, then "left right [weight [timestamp]]"
+    const char * c = line_buffer.c_str();
+    while (*c == ' ' || *c == '\t') ++c;
+    if (*c == '%' || *c == '\0') continue;
+    char * next;
+    unsigned long long ends[2];
+    ends[0] = std::strtoull(c, &next, 10);
+    if (next == c) continue;
+    c = next;
+    ends[1] = std::strtoull(c, &next, 10);
+    if (next == c) continue;
+    ++num_lines;
+    edge_key_t facet = ends[col];
+    edge_key_t vertex = ends[1 - col];
+    if (facet > 0xffffffffULL || vertex > 0xffffffffULL)
+    {
+      std::cerr << "Node ids must fit in 32 bits (line " << num_lines << ").\n";
+      remove_runs(runs);
+      return EXIT_FAILURE;
+    }
+    vertex_ids.push_back(vertex);
+    if (vertex_ids.size() == compact_at)
+    {
+      compact_ids(vertex_ids);
+      compact_at = std::max(compact_at, 2 * vertex_ids.size());
+    }
+    edges.push_back(facet << 32 | vertex);
+    if (edges.size() == capacity)
+    {
+      runs.push_back(new_run_path());
+      if (!write_run(edges, runs.back()))
+      {
+        std::cerr << "Cannot write run " << runs.back() << "\n";
+        remove_runs(runs);
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  file.close();
+  if (!runs.empty() && !edges.empty())
+  {
+    runs.push_back(new_run_path());
+    if (!write_run(edges, runs.back()))
+    {
+      std::cerr << "Cannot write run " << runs.back() << "\n";
+      remove_runs(runs);
+      return EXIT_FAILURE;
+    }
+  }
+  if (verbose) std::clog << "Read " << num_lines << " edges (" << runs.size() << " sorted runs).\n";
+  // Contiguous, order preserving, vertex ids: ranks in vertex_ids
+  compact_ids(vertex_ids);
+  vertex_ids.shrink_to_fit();
+  id_t N = vertex_ids.size();
+
+
+  /* ~~~~~ Group edges by facet ~~~~~~~*/
+  std::vector< std::vector<id_t> > facets;
+  edge_key_t current = ~(edge_key_t) 0;  // facet of the last edge
+  edge_key_t last_edge = ~(edge_key_t) 0;
+  auto add_edge = [&](edge_key_t e) {
+    if (e == last_edge) return;
+    last_edge = e;
+    if (e >> 32 != current)
+    {
+      current = e >> 32;
+      facets.push_back(std::vector<id_t>());
+    }
+    id_t vertex = e & 0xffffffffULL;
+    facets.back().push_back(std::lower_bound(vertex_ids.begin(), vertex_ids.end(), vertex) - vertex_ids.begin());
+  };
+  if (runs.empty())
+  {
+    std::sort(edges.begin(), edges.end());
+    for (edge_key_t e : edges) add_edge(e);
+    std::vector<edge_key_t>().swap(edges);
+  }
+  else
+  {
+    // k-way merge, the memory limit being shared by the run buffers. Runs
+    // are first merged in batches, until at most MAX_MERGE_FAN_IN remain.
+    std::vector<edge_key_t>().swap(edges);
+    while (runs.size() > MAX_MERGE_FAN_IN)
+    {
+      std::vector<std::string> merged;
+      for (std::size_t first = 0; first < runs.size(); first += MAX_MERGE_FAN_IN)
+      {
+        std::vector<std::string> batch(runs.begin() + first,
+                                       runs.begin() + std::min(first + MAX_MERGE_FAN_IN, runs.size()));
+        merged.push_back(new_run_path());
+        std::ofstream out(merged.back().c_str(), std::ios::binary);
+        // half of the memory for the inputs, half for the output buffer
+        std::vector<edge_key_t> buffer;
+        buffer.reserve(std::max<std::size_t>(capacity / 2, 1));
+        bool ok = out.is_open() && merge_runs(batch, std::max<std::size_t>(capacity / 2, batch.size()),
+          [&](edge_key_t e) {
+            buffer.push_back(e);
+            if (buffer.size() == buffer.capacity())
+            {
+              out.write(reinterpret_cast<const char *>(buffer.data()), buffer.size() * sizeof(edge_key_t));
+              buffer.clear();
+            }
+          });
+        out.write(reinterpret_cast<const char *>(buffer.data()), buffer.size() * sizeof(edge_key_t));
+        out.close();
+        remove_runs(batch);
+        if (!ok || !out)
+        {
+          std::cerr << "Cannot merge runs into " << merged.back() << "\n";
+          remove_runs(std::vector<std::string>(runs.begin() + std::min(first + MAX_MERGE_FAN_IN, runs.size()), runs.end()));
+          remove_runs(merged);
+          return EXIT_FAILURE;
+        }
+      }
+      runs.swap(merged);
+      if (verbose) std::clog << "Merged into " << runs.size() << " runs.\n";
+    }
+    bool ok = merge_runs(runs, std::max<std::size_t>(capacity, runs.size()), add_edge);
+    remove_runs(runs);
+    if (!ok) return EXIT_FAILURE;
+  }
+  if (verbose) std::clog << "Grouped into " << facets.size() << " facets on " << N << " vertices.\n";
+
+
+  /* ~~~~~ Prune and output ~~~~~~~*/
+  prune_facet_list(facets);
+  if (verbose) std::clog << facets.size() << " maximal facets.\n";
+  std::ofstream output_file;
+  if (!output_path.empty())
+  {
+    output_file.open(output_path.c_str());
+    if (!output_file.is_open())
+    {
+      std::cerr << "Cannot open output file " << output_path << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+  std::ostream & os = output_path.empty() ? std::cout : output_file;
+  for (const std::vector<id_t> & f : facets)
+  {
+    for (unsigned int i = 0; i < f.size(); ++i) os << (i > 0 ? " " : "") << f[i];
+    os << "\n";
+  }
+  return EXIT_SUCCESS;
+}
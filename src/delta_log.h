@@ -0,0 +1,334 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Delta-log output: store MCMC trajectories as accepted moves.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+#ifndef DELTA_LOG
+#define DELTA_LOG
+
+#include <algorithm>  // equal, set_difference
+#include <cstdint>
+#include <iostream>
+#include <iterator>  // back_inserter
+#include <memory>  // unique_ptr
+#include <string>
+#include <utility>
+#include <vector>
+#include "types.h"
+#include "scm/scm.h"
+
+// Binary format (native byte order):
+//   header:   "SCMDLOG1" F N M num_labels, then num_labels strings
+//             (uint32 length + bytes) mapping ids to vertex labels.
+//   records:  one tag byte followed by
+//     'I'  initial state: uint32 F, then F facets (uint32 size + vertex ids)
+//     'K'  keyframe: uint32 sample index, then the state as in 'I'
+//     'M'  moves: uint32 count, then count x (uint32 vertex, uint32 facet);
+//          the high bit of the facet field is set for attachments.
+//     'S'  sample: uint32 sample index
+// A sample is the state after all records preceding its 'S' or 'K' record.
+// All integers are uint32.
+
+static const char DELTA_LOG_MAGIC[8] = {'S', 'C', 'M', 'D', 'L', 'O', 'G', '1'};
+static const std::uint32_t DELTA_LOG_ATTACH_BIT = 0x80000000u;
+
+static inline void write_u32(std::ostream & os, std::uint32_t x)
+{
+  os.write(reinterpret_cast<const char *>(&x), sizeof(x));
+}
+
+static inline std::uint32_t read_u32(std::istream & is)
+{
+  std::uint32_t x = 0;
+  is.read(reinterpret_cast<char *>(&x), sizeof(x));
+  return x;
+}
+
+
+/** @class delta_log_writer_t
+  * @brief Writes the initial state once, then the accepted moves only.
+  *
+  * Moves are buffered between samples, and a full keyframe is written every
+  * keyframe_interval samples to allow fast random access.
+  */
+class delta_log_writer_t {
+public:
+  delta_log_writer_t(std::ostream & os, unsigned int keyframe_interval)
+    : os_(os), keyframe_interval_(keyframe_interval), num_samples_(0) {}
+
+  template <class complex_t>
+  void header(const complex_t & K, const vmap_t & id_to_vertex)
+  {
+    os_.write(DELTA_LOG_MAGIC, sizeof(DELTA_LOG_MAGIC));
+    write_u32(os_, K.F());
+    write_u32(os_, K.N());
+    write_u32(os_, K.M());
+    write_u32(os_, id_to_vertex.size());
+    for (id_t v = 0; v < id_to_vertex.size(); ++v)
+    {
+      write_u32(os_, id_to_vertex.length(v));
+      id_to_vertex.write(os_, v);
+    }
+    os_.put('I');
+    write_state(K);
+  }
+
+  /// Log an accepted move list. Incidences that are detached and attached
+  /// again (e.g., by identity proposals) are left out, since they do not
+  /// change the state.
+  template <class move_list_t>
+  void moves(const move_list_t & moves)
+  {
+    detached_.clear();
+    attached_.clear();
+    for (mcmc_move_t m : moves)
+      (m.attach ? attached_ : detached_).push_back(((std::uint64_t) m.vertex << 32) | m.facet);
+    std::sort(detached_.begin(), detached_.end());
+    std::sort(attached_.begin(), attached_.end());
+    // detachments first, as in the move lists
+    changed_.clear();
+    std::set_difference(detached_.begin(), detached_.end(), attached_.begin(), attached_.end(),
+                        std::back_inserter(changed_));
+    for (std::uint64_t e : changed_) push_move(e, false);
+    changed_.clear();
+    std::set_difference(attached_.begin(), attached_.end(), detached_.begin(), detached_.end(),
+                        std::back_inserter(changed_));
+    for (std::uint64_t e : changed_) push_move(e, true);
+  }
+
+  template <class complex_t>
+  void sample(const complex_t & K)
+  {
+    flush_moves();
+    if (keyframe_interval_ > 0 && num_samples_ % keyframe_interval_ == 0 && num_samples_ > 0)
+    {
+      os_.put('K');
+      write_u32(os_, num_samples_);
+      write_state(K);
+    }
+    else
+    {
+      os_.put('S');
+      write_u32(os_, num_samples_);
+    }
+    ++num_samples_;
+  }
+
+private:
+  std::ostream & os_;
+  unsigned int keyframe_interval_;
+  unsigned int num_samples_;
+  std::vector<std::uint32_t> pending_;
+  // scratch space of moves(), as (vertex << 32) | facet
+  std::vector<std::uint64_t> detached_;
+  std::vector<std::uint64_t> attached_;
+  std::vector<std::uint64_t> changed_;
+
+  void push_move(std::uint64_t incidence, bool attach)
+  {
+    pending_.push_back(incidence >> 32);
+    pending_.push_back((incidence & 0xffffffffu) | (attach ? DELTA_LOG_ATTACH_BIT : 0));
+  }
+
+  void flush_moves()
+  {
+    if (pending_.empty()) return;
+    os_.put('M');
+    write_u32(os_, pending_.size() / 2);
+    os_.write(reinterpret_cast<const char *>(pending_.data()), pending_.size() * sizeof(std::uint32_t));
+    pending_.clear();
+  }
+
+  template <class complex_t>
+  void write_state(const complex_t & K)
+  {
+    write_u32(os_, K.F());
+    for (id_t f = 0; f < K.F(); ++f)
+    {
+      neighborhood_t facet = K.facet_neighbors(f);
+      write_u32(os_, facet.size());
+      for (id_t v : facet) write_u32(os_, v);
+    }
+  }
+};
+
+
+/** @class delta_log_reader_t
+  * @brief Replays a delta log, sequentially or from the nearest keyframe.
+  */
+class delta_log_reader_t {
+public:
+  /// Reads the header; valid() is false if the stream is not a delta log.
+  delta_log_reader_t(std::istream & is)
+    : is_(is), valid_(false), sample_(0), indexed_(false)
+  {
+    char magic[sizeof(DELTA_LOG_MAGIC)];
+    is_.read(magic, sizeof(magic));
+    if (!is_ || !std::equal(magic, magic + sizeof(magic), DELTA_LOG_MAGIC)) return;
+    read_u32(is_);  // F, N and M are implied by the initial state
+    read_u32(is_);
+    read_u32(is_);
+    std::uint32_t num_labels = read_u32(is_);
+    for (id_t v = 0; v < num_labels; ++v)
+    {
+      std::string label(read_u32(is_), '\0');
+      is_.read(&label[0], label.size());
+      id_to_vertex_.insert(label);
+    }
+    if (is_.get() != 'I') return;
+    initial_state_ = is_.tellg();
+    read_state();
+    first_record_ = is_.tellg();
+    valid_ = (bool) is_;
+  }
+
+  bool valid() const {return valid_;}
+  const vmap_t & labels() const {return id_to_vertex_;}
+  const scm_t & state() const {return *K_;}
+  unsigned int sample_index() const {return sample_;}
+
+  /// Advance to the next sample. Returns false at the end of the log.
+  bool next_sample()
+  {
+    int tag;
+    while ((tag = is_.get()) != EOF)
+    {
+      switch (tag)
+      {
+        case 'M':
+          apply_moves();
+          break;
+        case 'S':
+          sample_ = read_u32(is_);
+          return (bool) is_;
+        case 'K':
+          sample_ = read_u32(is_);
+          skip_state();  // already in sync
+          return (bool) is_;
+        default:
+          return false;
+      }
+    }
+    return false;
+  }
+
+  /// Replay up to a given sample, starting from the nearest keyframe.
+  bool seek_sample(unsigned int sample)
+  {
+    if (!indexed_) build_index();
+    if (sample >= num_samples_) return false;
+    // last keyframe at or before the target
+    std::streampos start = first_record_;
+    std::streampos keyframe = -1;
+    for (auto k : keyframes_)
+    {
+      if (k.first > sample) break;
+      keyframe = k.second;
+      start = k.second;
+    }
+    is_.clear();
+    is_.seekg(start);
+    if (keyframe != std::streampos(-1))
+    {
+      is_.get();  // tag
+      sample_ = read_u32(is_);
+      read_state();
+      if (sample_ == sample) return true;
+    }
+    else
+    {
+      // back to the initial state
+      is_.seekg(initial_state_);
+      read_state();
+    }
+    while (next_sample())
+    {
+      if (sample_ == sample) return true;
+    }
+    return false;
+  }
+
+  /// Total number of samples in the log.
+  unsigned int num_samples()
+  {
+    if (!indexed_) build_index();
+    return num_samples_;
+  }
+
+private:
+  std::istream & is_;
+  bool valid_;
+  vmap_t id_to_vertex_;
+  std::unique_ptr<scm_t> K_;
+  unsigned int sample_;
+  std::streampos initial_state_;
+  std::streampos first_record_;
+  // random access
+  bool indexed_;
+  unsigned int num_samples_;
+  std::vector< std::pair<unsigned int, std::streampos> > keyframes_;
+
+  void read_state()
+  {
+    adj_list_t facets(read_u32(is_));
+    for (auto & facet : facets)
+    {
+      std::uint32_t size = read_u32(is_);
+      for (std::uint32_t i = 0; i < size; ++i) facet.insert(read_u32(is_));
+    }
+    K_.reset(new scm_t(facets));
+  }
+
+  void skip_state()
+  {
+    std::uint32_t F = read_u32(is_);
+    for (std::uint32_t f = 0; f < F; ++f)
+      is_.seekg(std::streamoff(read_u32(is_)) * sizeof(std::uint32_t), std::ios_base::cur);
+  }
+
+  void apply_moves()
+  {
+    std::uint32_t count = read_u32(is_);
+    std::vector<std::uint32_t> buffer(2 * count);
+    is_.read(reinterpret_cast<char *>(buffer.data()), buffer.size() * sizeof(std::uint32_t));
+    std::vector<mcmc_move_t> moves(count);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+      moves[i].vertex = buffer[2 * i];
+      moves[i].facet = buffer[2 * i + 1] & ~DELTA_LOG_ATTACH_BIT;
+      moves[i].attach = (buffer[2 * i + 1] & DELTA_LOG_ATTACH_BIT) != 0;
+    }
+    K_->apply_mcmc_moves(moves);
+  }
+
+  void build_index()
+  {
+    // Scan the records once, skipping over their bodies.
+    std::streampos current = is_.tellg();
+    is_.clear();
+    is_.seekg(first_record_);
+    num_samples_ = 0;
+    keyframes_.clear();
+    int tag;
+    while ((tag = is_.get()) != EOF)
+    {
+      std::streampos record = is_.tellg() - std::streamoff(1);
+      if (tag == 'M')
+        is_.seekg(std::streamoff(read_u32(is_)) * 2 * sizeof(std::uint32_t), std::ios_base::cur);
+      else if (tag == 'S')
+        read_u32(is_);
+      else if (tag == 'K')
+      {
+        keyframes_.push_back(std::make_pair(read_u32(is_), record));
+        skip_state();
+      }
+      else
+        break;
+      if (!is_) break;
+      if (tag != 'M') ++num_samples_;
+    }
+    indexed_ = true;
+    is_.clear();
+    is_.seekg(current);
+  }
+};
+
+#endif
@@ -0,0 +1,94 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Replay MCMC delta logs as facet lists
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// STL
+#include <cstdlib>   // EXIT_FAILURE, EXIT_SUCCESS
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+// Boost
+#include <boost/program_options.hpp>
+// Program headers
+#include "types.h"
+#include "scm/scm.h"
+#include "io_functions.h"
+#include "delta_log.h"
+
+namespace po = boost::program_options;
+
+int main(int argc, char const *argv[])
+{
+  /* ~~~~~ Program options ~~~~~~~*/
+  std::string delta_log_path;
+  std::vector<unsigned int> samples;
+  po::options_description description("Options");
+  description.add_options()
+  ("sample,i", po::value< std::vector<unsigned int> >(&samples),
+      "Index of a sample to output (0 indexed, can be repeated). Outputs all samples if not specified.")
+  ("count,n", "Only output the number of samples in the log.")
+  ("help,h", "Produce this help message.")
+  ;
+  po::options_description hidden;
+  hidden.add_options()
+  ("delta_log_path", po::value<std::string>(&delta_log_path),
+      "Path to delta log.")
+  ;
+  po::positional_options_description p;
+  p.add("delta_log_path", -1);
+  po::options_description all_options;
+  all_options.add(description);
+  all_options.add(hidden);
+  po::variables_map var_map;
+  po::store(po::command_line_parser(argc, argv).
+          options(all_options).
+          positional(p).
+          run(),
+          var_map);
+  po::notify(var_map);
+  if (var_map.count("help") || argc == 1)
+  {
+      std::cout << "Usage:\n"
+                << "  "+std::string(argv[0])+" [--option_1=VAL] ... [--option_n=VAL] path-to-delta-log\n";
+      std::cout << description;
+      return EXIT_SUCCESS;
+  }
+  if (!var_map.count("delta_log_path"))
+  {
+      std::cerr << "No delta log given.\n";
+      return EXIT_FAILURE;
+  }
+
+  std::ifstream file(delta_log_path.c_str(), std::ios::binary);
+  if (!file.is_open()) return EXIT_FAILURE;
+  delta_log_reader_t log(file);
+  if (!log.valid())
+  {
+      std::cerr << delta_log_path << " is not a delta log.\n";
+      return EXIT_FAILURE;
+  }
+  if (var_map.count("count"))
+  {
+    std::cout << log.num_samples() << std::endl;
+    return EXIT_SUCCESS;
+  }
+  if (samples.empty())
+  {
+    // sequential replay
+    while (log.next_sample())
+      output_K(log.state(), std::cout, log.labels(), true);
+  }
+  else
+  {
+    for (unsigned int i : samples)
+    {
+      if (!log.seek_sample(i))
+      {
+        std::cerr << "No sample " << i << " in " << delta_log_path << "\n";
+        return EXIT_FAILURE;
+      }
+      output_K(log.state(), std::cout, log.labels(), true);
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Simplicial Configuration Model exact enumerator (small ensembles)
+// Reference: https://doi.org/10.1103/PhysRevE.96.032312
+// arXiv link:  https://arxiv.org/abs/1705.10298
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// STL
+#include <cstdlib>   // EXIT_FAILURE, EXIT_SUCCESS
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+// Boost
+#include <boost/program_options.hpp>
+// Program headers
+#include "types.h"
+#include "scm/scm.h"
+#include "scm/enumeration.h"
+#include "io_functions.h"
+
+namespace po = boost::program_options;
+
+int main(int argc, char const *argv[])
+{
+  /* ~~~~~ Program options ~~~~~~~*/
+  std::string facet_list_path;
+  std::string degree_seq_file;
+  std::string size_seq_file;
+  unsigned int num_threads = std::thread::hardware_concurrency();
+
+  po::options_description description("Options");
+  description.add_options()
+  ("cleansed_input,c", "In facet list mode, assume that the input is already cleansed, i.e., that nodes are labeled with 0 indexed contiguous integers and that no facet is included in another.")
+  ("degree_seq_file,k", po::value<std::string>(&degree_seq_file),
+    "Path to degree sequence file.")
+  ("size_seq_file,s", po::value<std::string>(&size_seq_file),
+    "Path to size sequence file.")
+  ("threads,j", po::value<unsigned int>(&num_threads),
+    "Number of threads. Defaults to the number of hardware threads.")
+  ("output_all,a", "Output every simplicial complex of the ensemble.")
+  ("verbose,v", "Output log messages.")
+  ("help,h", "Produce help message.")
+  ;
+  po::options_description hidden;
+  hidden.add_options()
+  ("facet_list_path", po::value<std::string>(&facet_list_path),
+      "Path to facet list.")
+  ;
+  po::positional_options_description p;
+  p.add("facet_list_path", -1);
+  po::options_description all_options;
+  all_options.add(description);
+  all_options.add(hidden);
+  po::variables_map var_map;
+  po::store(po::command_line_parser(argc, argv).
+          options(all_options).
+          positional(p).
+          run(),
+          var_map);
+  po::notify(var_map);
+  if (var_map.count("help") || argc == 1)
+  {
+      std::cout << "Usage:\n"
+                << " [Facet list mode] "+std::string(argv[0])+" [--option_1=VAL] ... [--option_n=VAL] path-to-facet-list\n"
+                << " [Seq. mode] "+std::string(argv[0])+" [--option_1=VAL] ... -k path-to-degrees.txt -s path-to-sizes.txt\n";
+      std::cout << description;
+      return EXIT_SUCCESS;
+  }
+  if (!var_map.count("facet_list_path") && (!var_map.count("degree_seq_file") || !var_map.count("size_seq_file")))
+  {
+      std::cerr << "Missing facet list or sequences files.\n";
+      return EXIT_FAILURE;
+  }
+
+
+  /* ~~~~~ Load sequences ~~~~~~~*/
+  uint_vec_t d;
+  uint_vec_t s;
+  vmap_t id_to_vertex;
+  if (var_map.count("facet_list_path"))
+  {
+    if (var_map.count("verbose")) std::clog << "Loading facet file.\n";
+    adj_list_t maximal_facets;
+    std::ifstream file(facet_list_path.c_str());
+    if (!file.is_open()) return EXIT_FAILURE;
+    read_facet_list(maximal_facets, file, var_map.count("cleansed_input") != 0, id_to_vertex);
+    file.close();
+    scm_t K(maximal_facets);
+    for (id_t f = 0; f < K.F(); ++f) s.push_back(K.size(f));
+    for (id_t v = 0; v < K.N(); ++v) d.push_back(K.degree(v));
+  }
+  else
+  {
+    if (var_map.count("verbose")) std::clog << "Loading sequence files.\n";
+    {
+      std::ifstream file(degree_seq_file.c_str());
+      read_sequence_file(file, d);
+      file.close();
+    }
+    {
+      std::ifstream file(size_seq_file.c_str());
+      read_sequence_file(file, s);
+      file.close();
+    }
+  }
+  if (d.size() > 64)
+  {
+      std::cerr << "Exact enumeration is limited to 64 vertices (got " << d.size() << ").\n";
+      return EXIT_FAILURE;
+  }
+
+
+  /* ~~~~~ Enumeration ~~~~~~~*/
+  if (var_map.count("verbose"))
+  {
+    std::clog << "Parameters:\n";
+    std::clog << "\tF: " << s.size() << "\n";
+    std::clog << "\tN: " << d.size() << "\n";
+    std::clog << "\tthreads: " << num_threads << "\n";
+    std::clog << "Enumeration in progress\n";
+  }
+  enumeration_t E(s, d);
+  if (var_map.count("output_all"))
+  {
+    E.run(num_threads, [&id_to_vertex](const mask_list_t & facets) {
+      std::cout << "# Sample:\n";
+      for (facet_mask_t f : facets)
+      {
+        for (id_t v = 0; v < 64 && (f >> v) != 0; ++v)
+        {
+          if (!(f >> v & 1)) continue;
+          if (id_to_vertex.size() == 0) std::cout << v << " ";
+          else std::cout << id_to_vertex.at(v) << " ";
+        }
+        std::cout << "\n";
+      }
+    });
+  }
+  else
+  {
+    E.run(num_threads);
+  }
+
+
+  /* ~~~~~ Exact averages ~~~~~~~*/
+  std::cout << "# num_complexes=" << E.num_complexes() << "\n";
+  std::cout << "# Mean facet overlap histogram (overlap size, number of facet pairs):\n";
+  std::vector<double> overlap = E.mean_overlap_histogram();
+  for (unsigned int k = 0; k < overlap.size(); ++k)
+    std::cout << k << " " << overlap[k] << "\n";
+  std::cout << "# Mean co-membership (vertex, vertex, number of shared facets):\n";
+  for (auto pair : E.mean_comembership())
+  {
+    if (id_to_vertex.size() == 0)
+      std::cout << pair.first.first << " " << pair.first.second;
+    else
+      std::cout << id_to_vertex.at(pair.first.first) << " " << id_to_vertex.at(pair.first.second);
+    std::cout << " " << pair.second << "\n";
+  }
+  if (var_map.count("verbose")) std::clog << "Done.\n";
+  return EXIT_SUCCESS;
+}
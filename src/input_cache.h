@@ -0,0 +1,208 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Cache of preprocessed facet lists, shared by repeated runs.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+#ifndef INPUT_CACHE
+#define INPUT_CACHE
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>   // rename, remove
+#include <cstring>  // memcmp
+#include <fstream>
+#include <memory>  // unique_ptr
+#include <random>   // random_device
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>   // open, O_EXCL
+#include <unistd.h>  // close, getpid
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include "types.h"
+
+// Binary format (native byte order, all fields 8-byte aligned):
+//   "SCMCACH2", uint64 key, uint64 F, uint64 largest facet size, uint64 M,
+//   uint64 checksum of the payload, then the payload:
+//   F + 1 uint64 facet offsets, M uint32 vertex ids (padded to 8 bytes),
+//   and the label table as written by label_table_t::save().
+
+static const char INPUT_CACHE_MAGIC[8] = {'S', 'C', 'M', 'C', 'A', 'C', 'H', '2'};
+static const unsigned int INPUT_CACHE_HEADER_SIZE = 6;  // in uint64
+
+
+/** @class input_cache_t
+  * @brief Stores the cleansed, pruned and relabeled facet list of an input
+  *        file, along with its labels, in a file mapped by later runs.
+  *
+  * Cache files are named after a hash of the content of the input and of the
+  * preprocessing options, such that a modified input never hits a stale
+  * entry. Entries are written to a temporary file unique to the writer, then
+  * renamed, and their payload is checksummed, such that concurrent runs
+  * never load a partial entry. The labels of a loaded entry are used in
+  * place in the mapped file, hence the cache must outlive the label table
+  * it fills.
+  */
+class input_cache_t {
+public:
+  /// options: any string describing the preprocessing (e.g., reordering).
+  input_cache_t(const std::string & cache_dir, const std::string & input_path, const std::string & options)
+    : key_(0)
+  {
+    std::ifstream input(input_path.c_str(), std::ios::binary);
+    if (!input.is_open()) return;
+    key_ = content_hash(input, options);
+    std::ostringstream name;
+    name << cache_dir << "/" << std::hex << key_ << ".scmcache";
+    path_ = name.str();
+  }
+
+  const std::string & path() const {return path_;}
+
+  /// Returns false on a cache miss (or on an unreadable entry).
+  bool load(adj_list_t & maximal_facets, vmap_t & id_to_vertex, unsigned int & largest_facet)
+  {
+    namespace bip = boost::interprocess;
+    if (path_.empty()) return false;
+    {
+      std::ifstream probe(path_.c_str());
+      if (!probe.is_open()) return false;
+    }
+    try
+    {
+      bip::file_mapping file(path_.c_str(), bip::read_only);
+      region_.reset(new bip::mapped_region(file, bip::read_only));
+    }
+    catch (const bip::interprocess_exception &)
+    {
+      region_.reset();
+      return false;
+    }
+    const char * data = static_cast<const char *>(region_->get_address());
+    std::size_t size = region_->get_size();
+    const std::uint64_t * header = reinterpret_cast<const std::uint64_t *>(data);
+    const std::size_t header_size = INPUT_CACHE_HEADER_SIZE * sizeof(std::uint64_t);
+    if (size < header_size ||
+        std::memcmp(data, INPUT_CACHE_MAGIC, sizeof(INPUT_CACHE_MAGIC)) != 0 ||
+        header[1] != key_ ||
+        header[5] != hash_bytes(0, data + header_size, size - header_size))
+    {
+      region_.reset();
+      return false;
+    }
+    std::uint64_t F = header[2];
+    std::uint64_t M = header[4];
+    std::size_t labels_begin = header_size + (F + 1) * sizeof(std::uint64_t) + padded(M);
+    if (size < labels_begin || !id_to_vertex.attach(data + labels_begin, size - labels_begin))
+    {
+      region_.reset();
+      return false;
+    }
+    largest_facet = header[3];
+    const std::uint64_t * offsets = header + INPUT_CACHE_HEADER_SIZE;
+    const std::uint32_t * vertices = reinterpret_cast<const std::uint32_t *>(offsets + F + 1);
+    maximal_facets.clear();
+    maximal_facets.reserve(F);
+    for (std::uint64_t f = 0; f < F; ++f)
+      maximal_facets.push_back(neighborhood_t(vertices + offsets[f], vertices + offsets[f + 1]));
+    return true;
+  }
+
+  /// Write an entry, atomically. Returns false if it cannot be written.
+  bool store(const adj_list_t & maximal_facets, const vmap_t & id_to_vertex, unsigned int largest_facet) const
+  {
+    if (path_.empty()) return false;
+    std::string tmp_path;
+    if (!create_unique(tmp_path)) return false;
+    std::vector<std::uint64_t> offsets(1, 0);
+    for (auto & f : maximal_facets) offsets.push_back(offsets.back() + f.size());
+    // the payload is assembled first, for its checksum
+    std::ostringstream payload;
+    payload.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(std::uint64_t));
+    std::vector<std::uint32_t> vertices;
+    vertices.reserve(padded(offsets.back()) / sizeof(std::uint32_t));
+    for (auto & f : maximal_facets) vertices.insert(vertices.end(), f.begin(), f.end());
+    vertices.resize(padded(offsets.back()) / sizeof(std::uint32_t), 0);
+    payload.write(reinterpret_cast<const char *>(vertices.data()), vertices.size() * sizeof(std::uint32_t));
+    std::vector<std::uint32_t>().swap(vertices);
+    id_to_vertex.save(payload);
+    std::string bytes = payload.str();
+    std::uint64_t header[INPUT_CACHE_HEADER_SIZE];
+    std::memcpy(header, INPUT_CACHE_MAGIC, sizeof(INPUT_CACHE_MAGIC));
+    header[1] = key_;
+    header[2] = maximal_facets.size();
+    header[3] = largest_facet;
+    header[4] = offsets.back();
+    header[5] = hash_bytes(0, bytes.data(), bytes.size());
+    std::ofstream os(tmp_path.c_str(), std::ios::binary | std::ios::trunc);
+    os.write(reinterpret_cast<const char *>(header), sizeof(header));
+    os.write(bytes.data(), bytes.size());
+    os.close();
+    if (!os || std::rename(tmp_path.c_str(), path_.c_str()) != 0)
+    {
+      std::remove(tmp_path.c_str());
+      return false;
+    }
+    return true;
+  }
+
+private:
+  std::string path_;
+  hash_t key_;
+  std::unique_ptr<boost::interprocess::mapped_region> region_;
+
+  /// Bytes taken by M vertex ids, padded to a multiple of 8.
+  static std::size_t padded(std::uint64_t M)
+  {
+    return ((M * sizeof(std::uint32_t) + 7) / 8) * 8;
+  }
+
+  /// Mix n bytes into h, 8 at a time.
+  static hash_t hash_bytes(hash_t h, const char * data, std::size_t n)
+  {
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+      std::uint64_t word;
+      std::memcpy(&word, data + i, 8);
+      h = mix_hash(h ^ word);
+    }
+    for (; i < n; ++i) h = mix_hash(h ^ (unsigned char) data[i]);
+    return h;
+  }
+
+  static hash_t content_hash(std::ifstream & input, const std::string & options)
+  {
+    hash_t h = mix_hash(options.size());
+    for (char c : options) h = mix_hash(h ^ (unsigned char) c);
+    std::vector<char> buffer(1 << 20);
+    while (input)
+    {
+      input.read(buffer.data(), buffer.size());
+      h = hash_bytes(h, buffer.data(), input.gcount());
+    }
+    return h;
+  }
+
+  /// Create a new temporary file next to the entry, with a name unique to
+  /// this process (pid and random suffix, created exclusively).
+  bool create_unique(std::string & tmp_path) const
+  {
+    std::random_device device;
+    for (unsigned int attempt = 0; attempt < 16; ++attempt)
+    {
+      std::ostringstream name;
+      name << path_ << ".tmp." << getpid() << "." << std::hex << device();
+      int fd = ::open(name.str().c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+      if (fd >= 0)
+      {
+        ::close(fd);
+        tmp_path = name.str();
+        return true;
+      }
+      if (errno != EEXIST) return false;
+    }
+    return false;
+  }
+};
+
+#endif // INPUT_CACHE
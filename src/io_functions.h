@@ -10,13 +10,24 @@
 #include <set>
 #include <map>
 #include <algorithm>
+#include <cmath>  // isnan
+#include <vector>
 #include "types.h"
 #include "scm/scm.h"
+#include "scm/comembership.h"
 
 
-void output_K(const scm_t& K, std::ostream& os, const  vmap_t & id_to_vertex)
+template <class complex_t>
+void output_K(const complex_t& K, std::ostream& os, const  vmap_t & id_to_vertex, bool with_hash = false)
 {
-  os << "# Sample:" << std::endl;
+  os << "# Sample:";
+  if (with_hash)
+  {
+    // kept on the header line: each line starting with # opens a new sample.
+    os << " state_hash=" << std::hex << K.state_hash()
+       << " canonical_hash=" << K.canonical_hash() << std::dec;
+  }
+  os << std::endl;
   if (id_to_vertex.size() == 0)
   {
     for (id_t f = 0; f < K.F(); ++f)
@@ -34,13 +45,15 @@ void output_K(const scm_t& K, std::ostream& os, const  vmap_t & id_to_vertex)
     {
       for (auto v: K.facet_neighbors(f))
       {
-        os << id_to_vertex.at(v) << " ";
+        id_to_vertex.write(os, v);
+        os << " ";
       }
       os << std::endl;
     }
   }
 }
-void output_K(const scm_t& K, std::ostream& os)
+template <class complex_t>
+void output_K(const complex_t& K, std::ostream& os)
 {
   os << "# Sample:" << std::endl;
   for (id_t f = 0; f < K.F(); ++f)
@@ -53,11 +66,66 @@ void output_K(const scm_t& K, std::ostream& os)
   }
 }
 
+template <class complex_t>
+void get_facet_list(const complex_t& K, adj_list_t & facets)
+{
+  facets.resize(K.F());
+  for (id_t f = 0; f < K.F(); ++f)
+  {
+    facets[f] = K.facet_neighbors(f);
+  }
+}
+
 static inline void ltrim(std::string &s) {
     s.erase(s.begin(), std::find_if(s.begin(), s.end(),
             std::not1(std::ptr_fun<int, int>(std::isspace))));
 }
 
+/// Remove repeated facets and facets included in another facet. Remaining
+/// facets are sorted by increasing size, then lexicographically.
+/// facet_list_t is a list of sorted containers of vertex ids, e.g., adj_list_t.
+template <class facet_list_t>
+void prune_facet_list(facet_list_t & facets)
+{
+  typedef typename facet_list_t::value_type facet_t;
+  // Largest facets first, such that a facet can only be included in facets
+  // that are already kept.
+  std::sort(facets.begin(), facets.end(), [](const facet_t & a, const facet_t & b) {
+    return a.size() > b.size() || (a.size() == b.size() && a < b);
+  });
+  facets.erase(std::unique(facets.begin(), facets.end()), facets.end());
+  id_t N = 0;
+  for (const facet_t & f : facets)
+    if (f.size() > 0) N = std::max(N, *std::max_element(f.begin(), f.end()) + 1);
+  // Index of the kept facets: a facet including f contains all its
+  // vertices, so candidates are those of its least covered vertex.
+  std::vector< std::vector<id_t> > kept_of(N);
+  facet_list_t kept;
+  for (facet_t & f : facets)
+  {
+    if (f.size() == 0) continue;
+    id_t pivot = *f.begin();
+    for (id_t v : f)
+      if (kept_of[v].size() < kept_of[pivot].size()) pivot = v;
+    bool included = false;
+    for (id_t g : kept_of[pivot])
+    {
+      if (std::includes(kept[g].begin(), kept[g].end(), f.begin(), f.end()))
+      {
+        included = true;
+        break;
+      }
+    }
+    if (included) continue;
+    for (id_t v : f) kept_of[v].push_back(kept.size());
+    kept.push_back(std::move(f));
+  }
+  std::sort(kept.begin(), kept.end(), [](const facet_t & a, const facet_t & b) {
+    return a.size() < b.size() || (a.size() == b.size() && a < b);
+  });
+  facets.swap(kept);
+}
+
 unsigned int read_facet_list(adj_list_t & maximal_facets, std::ifstream& file, bool cleansed_input, vmap_t & id_to_vertex)
 {
   std::string line_buffer;
@@ -65,8 +133,7 @@ unsigned int read_facet_list(adj_list_t & maximal_facets, std::ifstream& file, b
   unsigned int largest_facet = 0;
   if (!cleansed_input)
   {
-    // read facet list and setup map
-    std::map<std::string, id_t> vertex_to_id; // potentially useless, declase in case the input has to be sanetized
+    // read facet list and intern labels
     while (getline(file, line_buffer))
     {
       ltrim(line_buffer);
@@ -79,68 +146,16 @@ unsigned int read_facet_list(adj_list_t & maximal_facets, std::ifstream& file, b
           neighborhood_t neighborhood;
           while (ls >> vertex)
           {
-            auto id = vertex_to_id.find(vertex);
-            if (id == vertex_to_id.end())
-            {
-              vertex_to_id[vertex] = v;
-              id_to_vertex[v] = vertex;
-              neighborhood.insert(v);
-              ++v;
-            }
-            else
-            {
-              neighborhood.insert(id->second);
-            }
+            id_t id = id_to_vertex.insert(vertex);
+            if (id == v) ++v;  // new label
+            neighborhood.insert(id);
           }
           maximal_facets.push_back(neighborhood);
           if (neighborhood.size() > largest_facet) largest_facet = neighborhood.size();
         }
       }
     }
-    vertex_to_id.clear();  // only needed to setup id_to_vertex faster.
-    // prune
-    unsigned int original_size = maximal_facets.size();
-    std::set<unsigned int> sizes;
-    for (auto f: maximal_facets) sizes.insert(f.size());
-    std::map<unsigned int, adj_list_t> facet_by_size;
-    for (auto f: maximal_facets)
-    {
-      facet_by_size[f.size()].push_back(f);
-    }
-    // remove repetitions
-    for (auto s: facet_by_size)
-    {
-      std::set<neighborhood_t> tmp(facet_by_size[s.first].begin(), facet_by_size[s.first].end());
-      facet_by_size[s.first].clear();
-      facet_by_size[s.first] = adj_list_t(tmp.begin(), tmp.end());
-    }
-    // remopve included facets
-    auto ref_size_it = sizes.end();
-    for (--ref_size_it; ref_size_it != sizes.begin(); --ref_size_it) // starts pass back()
-    {
-      for (auto ref_set: facet_by_size[*ref_size_it])
-      {
-        for (auto s: sizes)
-        {
-          if (s < *ref_size_it)
-          {
-            adj_list_t tmp;
-            tmp.reserve(facet_by_size[s].size());
-            for (auto f: facet_by_size[s])
-            {
-              if (!std::includes(ref_set.begin(), ref_set.end(), f.begin(), f.end())) tmp.push_back(f);
-            }
-            facet_by_size[s] = tmp;
-          }
-        }
-      }
-    }
-    // put in memory
-    maximal_facets.clear();
-    for (auto s: facet_by_size)
-    {
-      maximal_facets.insert(maximal_facets.end(), s.second.begin(), s.second.end());
-    }
+    prune_facet_list(maximal_facets);
   }
   else
   {
@@ -162,6 +177,114 @@ unsigned int read_facet_list(adj_list_t & maximal_facets, std::ifstream& file, b
   return largest_facet; // weird return.. but speed up things a bit
 }
 
+/// Relabel vertices and facets for cache locality.
+/// Methods: "none", "degree" (decreasing degree) and "rcm" (reverse
+/// Cuthill-McKee over the vertex-facet incidence graph). Original labels
+/// are kept in id_to_vertex, such that output_K is unaffected.
+/// Returns false if the method is unknown.
+bool reorder_facet_list(adj_list_t & maximal_facets, vmap_t & id_to_vertex, const std::string & method)
+{
+  if (method == "none") return true;
+  if (method != "degree" && method != "rcm") return false;
+  // Incidence structure
+  unsigned int F = maximal_facets.size();
+  unsigned int N = 0;
+  for (auto & f : maximal_facets)
+    if (!f.empty()) N = std::max(N, *f.rbegin() + 1);
+  std::vector< std::vector<id_t> > facets_of(N);
+  for (id_t f = 0; f < F; ++f)
+    for (id_t v : maximal_facets[f]) facets_of[v].push_back(f);
+
+  std::vector<id_t> vertex_order;  // new id -> old id
+  std::vector<id_t> facet_order;
+  if (method == "degree")
+  {
+    vertex_order.resize(N);
+    for (id_t v = 0; v < N; ++v) vertex_order[v] = v;
+    std::stable_sort(vertex_order.begin(), vertex_order.end(),
+      [&facets_of](id_t a, id_t b) {return facets_of[a].size() > facets_of[b].size();});
+  }
+  else
+  {
+    // Cuthill-McKee on the bipartite graph: nodes [0, N) are vertices and
+    // nodes [N, N + F) are facets. Each component is started from one of
+    // its vertices of lowest degree, and neighbors are visited by
+    // increasing degree.
+    auto degree = [&](id_t node) -> std::size_t {
+      return node < N ? facets_of[node].size() : maximal_facets[node - N].size();
+    };
+    std::vector<id_t> seeds(N);
+    for (id_t v = 0; v < N; ++v) seeds[v] = v;
+    std::stable_sort(seeds.begin(), seeds.end(),
+      [&](id_t a, id_t b) {return degree(a) < degree(b);});
+    std::vector<bool> visited(N + F, false);
+    std::vector<id_t> order;
+    order.reserve(N + F);
+    for (id_t seed : seeds)
+    {
+      if (visited[seed]) continue;
+      visited[seed] = true;
+      std::size_t head = order.size();
+      order.push_back(seed);
+      for (; head < order.size(); ++head)
+      {
+        id_t node = order[head];
+        std::vector<id_t> next;
+        if (node < N)
+        {
+          for (id_t f : facets_of[node]) next.push_back(f + N);
+        }
+        else
+        {
+          next.assign(maximal_facets[node - N].begin(), maximal_facets[node - N].end());
+        }
+        std::stable_sort(next.begin(), next.end(),
+          [&](id_t a, id_t b) {return degree(a) < degree(b);});
+        for (id_t x : next)
+        {
+          if (visited[x]) continue;
+          visited[x] = true;
+          order.push_back(x);
+        }
+      }
+    }
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+      if (*it < N) vertex_order.push_back(*it);
+      else facet_order.push_back(*it - N);
+    }
+  }
+  // Relabel vertices
+  std::vector<id_t> new_id(N);
+  for (id_t v = 0; v < N; ++v) new_id[vertex_order[v]] = v;
+  vmap_t new_id_to_vertex;
+  for (id_t v = 0; v < N; ++v)
+  {
+    if (id_to_vertex.size() == 0) new_id_to_vertex.insert(std::to_string(vertex_order[v]));
+    else new_id_to_vertex.insert(id_to_vertex.data(vertex_order[v]), id_to_vertex.length(vertex_order[v]));
+  }
+  std::swap(id_to_vertex, new_id_to_vertex);
+  for (auto & f : maximal_facets)
+  {
+    neighborhood_t relabeled;
+    for (id_t v : f) relabeled.insert(new_id[v]);
+    f.swap(relabeled);
+  }
+  // Reorder facets; by default, facets follow their first vertex.
+  if (facet_order.empty())
+  {
+    facet_order.resize(F);
+    for (id_t f = 0; f < F; ++f) facet_order[f] = f;
+    std::stable_sort(facet_order.begin(), facet_order.end(),
+      [&maximal_facets](id_t a, id_t b) {return maximal_facets[a] < maximal_facets[b];});
+  }
+  adj_list_t reordered;
+  reordered.reserve(F);
+  for (id_t f : facet_order) reordered.push_back(maximal_facets[f]);
+  maximal_facets.swap(reordered);
+  return true;
+}
+
 void read_sequence_file(std::ifstream& file, uint_vec_t & seq)
 {
   seq.clear();
@@ -182,4 +305,104 @@ void read_sequence_file(std::ifstream& file, uint_vec_t & seq)
   }
 }
 
+/// Ensemble statistics of an accumulator (after merge()), against the
+/// observed complex. Pairs of vertices are reported if they share at least
+/// one facet in the observed complex, by decreasing z-score.
+void output_comembership_report(const comembership_accumulator_t & stats, const adj_list_t & observed,
+                                unsigned int max_size, const vmap_t & id_to_vertex, std::ostream & os)
+{
+  unsigned int n = stats.num_samples();
+  os << "# num_samples=" << n << "\n";
+  os << "# Facet overlap histogram (overlap size, observed, mean, std, z-score):\n";
+  std::vector<unsigned long long> histogram = overlap_histogram(observed, max_size);
+  const std::vector<moments_t> & overlap = stats.overlap();
+  for (unsigned int k = 0; k < std::max(histogram.size(), overlap.size()); ++k)
+  {
+    double x = k < histogram.size() ? histogram[k] : 0;
+    moments_t m = k < overlap.size() ? overlap[k] : moments_t();
+    os << k << " " << x << " " << m.mean(n) << " " << m.sd(n) << " " << m.z_score(x, n) << "\n";
+  }
+  os << "# Co-membership (vertex, vertex, observed, mean, std, z-score):\n";
+  pair_count_t counts = comembership_counts(observed);
+  std::vector< std::pair<double, vertex_pair_t> > ranking;
+  ranking.reserve(counts.size());
+  for (auto & pair : counts)
+  {
+    auto it = stats.comembership().find(pair.first);
+    moments_t m = it != stats.comembership().end() ? it->second : moments_t();
+    ranking.push_back(std::make_pair(m.z_score(pair.second, n), pair.first));
+  }
+  // decreasing z-scores, undefined ones last
+  std::sort(ranking.begin(), ranking.end(),
+    [](const std::pair<double, vertex_pair_t> & a, const std::pair<double, vertex_pair_t> & b) {
+      if (std::isnan(a.first) || std::isnan(b.first))
+        return std::isnan(b.first) && (!std::isnan(a.first) || a.second < b.second);
+      return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+  for (auto & entry : ranking)
+  {
+    id_t u = entry.second >> 32;
+    id_t v = entry.second & 0xffffffffu;
+    auto it = stats.comembership().find(entry.second);
+    moments_t m = it != stats.comembership().end() ? it->second : moments_t();
+    if (id_to_vertex.size() == 0) os << u << " " << v;
+    else
+    {
+      id_to_vertex.write(os, u);
+      os << " ";
+      id_to_vertex.write(os, v);
+    }
+    os << " " << counts[entry.second] << " " << m.mean(n) << " " << m.sd(n) << " " << entry.first << "\n";
+  }
+}
+
+/// Violations found by basic_scm_t::validate(), one per line, with the
+/// vertices of the facets involved.
+template <class complex_t>
+void output_validation_report(const validation_report_t & report, const complex_t & K,
+                              const vmap_t & id_to_vertex, std::ostream & os)
+{
+  auto write_facet = [&](id_t f) {
+    os << "{";
+    bool first = true;
+    for (id_t v : K.facet_neighbors(f))
+    {
+      if (!first) os << " ";
+      first = false;
+      if (id_to_vertex.size() == 0) os << v;
+      else id_to_vertex.write(os, v);
+    }
+    os << "}";
+  };
+  for (id_t f : report.multiedges)
+  {
+    os << "Repeated vertex in facet ";
+    write_facet(f);
+    os << "\n";
+  }
+  for (auto & pair : report.inclusions)
+  {
+    os << "Facet ";
+    write_facet(pair.first);
+    os << " is included in facet ";
+    write_facet(pair.second);
+    os << "\n";
+  }
+}
+
+/// Check that K is a simplicial complex, with the help of pool if not null.
+/// If it is not, the violations are listed on os, after a line naming K.
+template <class complex_t>
+bool validate_complex(const complex_t & K, thread_pool_t * pool, const std::string & name,
+                      const vmap_t & id_to_vertex, std::ostream & os)
+{
+  if (K.validate(pool)) return true;
+  // second pass for the full diagnostic, only on failure
+  validation_report_t report;
+  K.validate(pool, &report);
+  os << name << " is not a simplicial complex:\n";
+  output_validation_report(report, K, id_to_vertex, os);
+  return false;
+}
+
 #endif
\ No newline at end of file
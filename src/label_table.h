@@ -0,0 +1,154 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Compact table of interned vertex labels.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+#ifndef LABEL_TABLE_H
+#define LABEL_TABLE_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>  // memcmp
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/types.h>  // id_t
+
+
+/** @class label_table_t
+  * @brief Bidirectional map between vertex ids and string labels.
+  *
+  * Labels are stored back to back in a single byte pool, and label i spans
+  * [offset(i), offset(i + 1)). Lookups id -> label are O(1), and insert()
+  * finds existing labels through an open addressing hash index of ids.
+  *
+  * The serialized form (see save()) is the header followed by the offsets
+  * and the pool, such that a mapped file can be used in place with attach().
+  * Attached tables are read-only and have no hash index: they only look up
+  * labels by id, which is safe for concurrent readers.
+  */
+class label_table_t {
+public:
+  label_table_t() : external_offsets_(nullptr), external_pool_(nullptr), external_size_(0)
+  {
+    offsets_.push_back(0);
+  }
+
+  /// Number of labels.
+  std::size_t size() const {return external_pool_ ? external_size_ : offsets_.size() - 1;}
+  void clear()
+  {
+    detach();
+    offsets_.assign(1, 0);
+    pool_.clear();
+    index_.clear();
+  }
+
+  /// Id of a label, inserted at the end of the table if new.
+  id_t insert(const char * label, std::size_t length)
+  {
+    assert(external_pool_ == nullptr);
+    if (2 * (size() + 1) > index_.size()) rehash(std::max<std::size_t>(16, 4 * (size() + 1)));
+    std::size_t slot = find_slot(label, length);
+    if (index_[slot] != 0) return index_[slot] - 1;
+    id_t id = size();
+    pool_.insert(pool_.end(), label, label + length);
+    offsets_.push_back(pool_.size());
+    index_[slot] = id + 1;
+    return id;
+  }
+  id_t insert(const std::string & label) {return insert(label.data(), label.size());}
+
+  /// Label of an id.
+  const char * data(id_t id) const {return pool() + offsets()[id];}
+  std::size_t length(id_t id) const {return offsets()[id + 1] - offsets()[id];}
+  std::string at(id_t id) const
+  {
+    assert(id < size());
+    return std::string(data(id), length(id));
+  }
+  void write(std::ostream & os, id_t id) const {os.write(data(id), length(id));}
+
+  /** @name Serialization
+    * Layout: "SCMLBL1" '\0', uint64 number of labels n, uint64 pool size,
+    * n + 1 uint64 offsets, and the pool (native byte order).
+    */
+  //@{
+  void save(std::ostream & os) const
+  {
+    std::uint64_t header[3];
+    std::memcpy(header, "SCMLBL1", 8);
+    header[1] = size();
+    header[2] = offsets()[size()];
+    os.write(reinterpret_cast<const char *>(header), sizeof(header));
+    os.write(reinterpret_cast<const char *>(offsets()), (size() + 1) * sizeof(std::uint64_t));
+    os.write(pool(), header[2]);
+  }
+  /// Use a serialized table in place (e.g., in a mapped file), without copy.
+  /// The buffer must be 8-byte aligned and outlive the table.
+  bool attach(const char * buffer, std::size_t buffer_size)
+  {
+    clear();
+    if (buffer_size < 3 * sizeof(std::uint64_t) || std::memcmp(buffer, "SCMLBL1", 8) != 0) return false;
+    const std::uint64_t * header = reinterpret_cast<const std::uint64_t *>(buffer);
+    if (buffer_size < 3 * sizeof(std::uint64_t) + (header[1] + 1) * sizeof(std::uint64_t) + header[2]) return false;
+    external_size_ = header[1];
+    external_offsets_ = header + 3;
+    external_pool_ = reinterpret_cast<const char *>(external_offsets_ + external_size_ + 1);
+    return true;
+  }
+  //@}
+
+private:
+  std::vector<std::uint64_t> offsets_;
+  std::vector<char> pool_;
+  // hash index: slots hold id + 1, 0 for empty slots
+  std::vector<std::uint32_t> index_;
+  // attached (read-only) storage
+  const std::uint64_t * external_offsets_;
+  const char * external_pool_;
+  std::size_t external_size_;
+
+  const std::uint64_t * offsets() const {return external_pool_ ? external_offsets_ : offsets_.data();}
+  const char * pool() const {return external_pool_ ? external_pool_ : pool_.data();}
+  void detach()
+  {
+    external_offsets_ = nullptr;
+    external_pool_ = nullptr;
+    external_size_ = 0;
+  }
+
+  static std::uint64_t hash(const char * label, std::size_t length)
+  {
+    // FNV-1a
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (std::size_t i = 0; i < length; ++i)
+    {
+      h ^= (unsigned char) label[i];
+      h *= 0x100000001b3ULL;
+    }
+    return h;
+  }
+  std::size_t find_slot(const char * label, std::size_t length) const
+  {
+    // linear probing; the capacity is a power of 2
+    std::size_t mask = index_.size() - 1;
+    std::size_t slot = hash(label, length) & mask;
+    while (index_[slot] != 0)
+    {
+      id_t id = index_[slot] - 1;
+      if (this->length(id) == length && std::memcmp(data(id), label, length) == 0) break;
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+  void rehash(std::size_t min_capacity)
+  {
+    std::size_t capacity = 16;
+    while (capacity < min_capacity) capacity *= 2;
+    index_.assign(capacity, 0);
+    for (id_t id = 0; id < size(); ++id)
+      index_[find_slot(data(id), length(id))] = id + 1;
+  }
+};
+
+#endif // LABEL_TABLE_H
@@ -9,9 +9,13 @@
 #include <fstream> // handle facet_list text file
 #include <cmath>   // pow, exp
 #include <chrono>  // high_resolution_clock
+#include <array>
 #include <vector>
 #include <random>  // mt19937
 #include <algorithm>  // max
+#include <unordered_set>
+#include <memory>  // unique_ptr
+#include <thread>  // hardware_concurrency
 // Boost
 #include <boost/program_options.hpp>    
 #include <boost/math/special_functions/binomial.hpp>
@@ -19,43 +23,298 @@
 #include "types.h"
 #include "scm/scm.h"
 #include "io_functions.h"
+#include "input_cache.h"
+#include "backend.h"
+#include "delta_log.h"
+#include "thread_pool.h"
+#include "scm/homology.h"
+#include "scm/comembership.h"
 
 namespace po = boost::program_options;
 
-int main(int argc, char const *argv[])
+/// Parameters of the chain, see the program options.
+struct chain_parameters_t
 {
-  /* ~~~~~ Program options ~~~~~~~*/
   std::string facet_list_path;
-  unsigned int burn_in;
-  unsigned int sampling_steps;
-  unsigned int sampling_frequency;
+  std::string reorder = "none";
+  std::string cache_dir;
+  std::string backend = "adjacency";
+  std::string report_path;
+  std::string delta_log_path;
+  unsigned int keyframe_interval = 100;
+  unsigned int betti_dim = 0;
+  unsigned int num_threads = std::thread::hardware_concurrency();
+  unsigned int burn_in = 0;
+  unsigned int sampling_steps = 0;
+  unsigned int sampling_frequency = 0;
   unsigned int seed = 0;
   unsigned int L_max = 0;
   float prop_param = 1;
+};
+
+/// Run the chain from the input complex, with the storage policy of complex_t.
+template <class complex_t>
+int run_chain(chain_parameters_t param, const po::variables_map & var_map, const adj_list_t & maximal_facets,
+              const vmap_t & id_to_vertex, unsigned int largest_facet)
+{
+  /* ~~~~~ Sampling ~~~~~~~*/
+  complex_t K(maximal_facets);
+  std::vector<uint_vec_t> betti;
+  std::unique_ptr<comembership_accumulator_t> stats;
+  // samples are analyzed in parallel while the chain keeps running, and
+  // validated with the same threads. Declared after betti and stats, such
+  // that on early returns, the queued tasks are drained before those go.
+  std::unique_ptr<thread_pool_t> pool;
+  if (var_map.count("betti") || var_map.count("comembership_report") ||
+      (var_map.count("validate") && param.num_threads > 1))
+    pool.reset(new thread_pool_t(param.num_threads, 2 * param.num_threads));
+  if (var_map.count("validate"))
+  {
+    if (!validate_complex(K, pool.get(), "The input", id_to_vertex, std::cerr)) return EXIT_FAILURE;
+    if (var_map.count("verbose")) std::clog << "The input is a simplicial complex.\n";
+  }
+  std::mt19937 engine(param.seed);
+  // prepare proposal distribution
+  if (!var_map.count("l_max")) 
+  {
+    param.L_max = std::min(std::max((unsigned int) 0.1 * K.M(), 2 * largest_facet), K.M());
+  }
+  if (param.L_max < 2 * largest_facet && var_map.count("l_max"))
+  {
+    std::clog << "Warning: Manually set L_max does not guarantee connectivity. ("<< param.L_max << " < " << 2 * largest_facet << ")\n";
+  }
+  std::vector<double> weights(param.L_max + 1, 0);
+  if (var_map.count("exp_prop"))
+  {
+    for (unsigned int l = 2; l <= param.L_max; ++l) weights[l] = exp(l * param.prop_param);
+  }
+  else if (var_map.count("pl_prop"))
+  {
+    for (unsigned int l = 2; l <= param.L_max; ++l) weights[l] = pow(l, -param.prop_param);
+  }
+  else 
+  { // uniform (default)
+    for (unsigned int l = 2; l <= param.L_max; ++l) weights[l] = 1;
+  }
+  std::discrete_distribution<> rand_int(weights.begin(), weights.end());
+
+
+  if (!var_map.count("sampling_frequency"))
+  {
+    param.sampling_frequency = (unsigned int) K.M() * std::log(K.M());
+  }
+  if (!var_map.count("burn_in"))
+  {
+    param.burn_in = (unsigned int) K.M() * std::log(K.M());
+  }
+  // finally ready to output params (need initialized proposal for that)
+  if (var_map.count("verbose"))
+  {
+    std::clog << "Parameters:\n";
+    std::clog << "\tfacet_list_path: " << param.facet_list_path << "\n";
+    std::clog << "\tburn_in: " << param.burn_in << "\n";
+    std::clog << "\tsampling_steps: " << param.sampling_steps << "\n";
+    std::clog << "\tsampling_frequency: " << param.sampling_frequency << "\n";
+    std::clog << "\tseed: " << param.seed << "\n";
+    std::clog << "\tL_max: " << param.L_max << "\n";
+    std::clog << "\tproposal_distribution: ";
+    if (var_map.count("exp_prop")) {std::clog << "exponential\n";}
+    else if (var_map.count("pl_prop")) {std::clog << "power law\n";}
+    else {std::clog << "uniform\n";}
+    std::clog << "\tprop_param: " << param.prop_param << "\n";
+    std::clog << "\treorder: " << param.reorder << "\n";
+    std::clog << "\tcleansed_input: ";
+    if (var_map.count("cleansed_input")) {std::clog << "yes\n";}
+    else {std::clog << " no\n";}
+  }
+  std::array<mcmc_move_t, 4> swap_moves;
+  // Burn-in
+  if (var_map.count("verbose")) std::clog << "Burn-in in progress\n";
+  for (unsigned int t = 0; t < param.burn_in;)
+  {
+    unsigned int l = rand_int(engine);
+    if (l == 2)
+    {
+      if (K.do_double_swap(engine, swap_moves)) ++t;
+      continue;
+    }
+    auto moves = K.random_rewire(l, engine);
+    if (K.do_moves(moves)) ++t;
+  }
+  // Sample
+  if (var_map.count("verbose")) std::clog << "Starting sampling\n";  
+  std::ofstream delta_log_file;
+  std::unique_ptr<delta_log_writer_t> delta_log;
+  if (var_map.count("delta_log"))
+  {
+    delta_log_file.open(param.delta_log_path.c_str(), std::ios::binary);
+    if (!delta_log_file.is_open())
+    {
+      std::cerr << "Cannot open delta log file " << param.delta_log_path << "\n";
+      return EXIT_FAILURE;
+    }
+    delta_log.reset(new delta_log_writer_t(delta_log_file, param.keyframe_interval));
+    delta_log->header(K, id_to_vertex);
+  }
+  if (var_map.count("betti")) betti.resize(param.sampling_steps);
+  if (var_map.count("comembership_report")) stats.reset(new comembership_accumulator_t(pool->size(), largest_facet));
+  unsigned int accepted = 0;
+  auto sampling_start = std::chrono::steady_clock::now();
+  std::vector<hash_t> state_hashes;
+  std::vector<hash_t> canonical_hashes;
+  for (unsigned int t = 1; t < param.sampling_steps * param.sampling_frequency + 1; ++t)
+  {
+    unsigned int l = rand_int(engine);
+    if (l == 2)
+    {
+      // fast path for the most common proposals
+      if (K.do_double_swap(engine, swap_moves))
+      {
+        ++accepted;
+        if (delta_log) delta_log->moves(swap_moves);
+      }
+    }
+    else
+    {
+      auto moves = K.random_rewire(l, engine);
+      if (K.do_moves(moves))
+      {
+        ++accepted;
+        if (delta_log) delta_log->moves(moves);
+      }
+    }
+    if (t % param.sampling_frequency == 0)
+    {
+      if (var_map.count("validate") &&
+          !validate_complex(K, pool.get(), "Sample " + std::to_string(t / param.sampling_frequency - 1),
+                            id_to_vertex, std::cerr))
+        return EXIT_FAILURE;
+      if (delta_log) delta_log->sample(K);
+      else if (!var_map.count("betti")) output_K(K, std::cout, id_to_vertex, true);
+      if (!betti.empty() || stats)
+      {
+        adj_list_t snapshot;
+        get_facet_list(K, snapshot);
+        unsigned int sample = t / param.sampling_frequency - 1;
+        pool->submit([&betti, &stats, &param, snapshot, sample]() {
+          if (!betti.empty()) betti[sample] = betti_numbers(snapshot, param.betti_dim);
+          if (stats) stats->add(snapshot);
+        });
+      }
+      state_hashes.push_back(K.state_hash());
+      canonical_hashes.push_back(K.canonical_hash());
+    }
+  }
+  float acceptance_ratio = float(accepted) / float(param.sampling_steps * param.sampling_frequency);
+  double sampling_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - sampling_start).count();
+  if (pool) pool->wait();
+  if (stats)
+  {
+    stats->merge();
+    std::ofstream report(param.report_path.c_str());
+    if (!report.is_open())
+    {
+      std::cerr << "Cannot open report file " << param.report_path << "\n";
+      return EXIT_FAILURE;
+    }
+    output_comembership_report(*stats, maximal_facets, largest_facet, id_to_vertex, report);
+  }
+  if (var_map.count("betti"))
+  {
+    std::cout << "# Betti numbers b_0 ... b_" << param.betti_dim << "\n";
+    std::cout << "# observed:";
+    for (unsigned int b : betti_numbers(maximal_facets, param.betti_dim)) std::cout << " " << b;
+    std::cout << "\n";
+    for (const uint_vec_t & b : betti)
+    {
+      for (unsigned int k = 0; k < b.size(); ++k) std::cout << (k > 0 ? " " : "") << b[k];
+      std::cout << "\n";
+    }
+  }
+  if (var_map.count("verbose"))
+  {
+    std::clog << "# acceptance_ratio=" << acceptance_ratio << "\n";
+    std::clog << "# moves_per_second=" << (param.sampling_steps * param.sampling_frequency) / sampling_time << "\n";
+    // Mixing diagnostics based on the state hashes of the samples
+    std::unordered_set<hash_t> distinct_states(state_hashes.begin(), state_hashes.end());
+    std::unordered_set<hash_t> distinct_canonical(canonical_hashes.begin(), canonical_hashes.end());
+    std::clog << "# distinct_states=" << distinct_states.size() << "\n";
+    std::clog << "# distinct_canonical_states=" << distinct_canonical.size() << "\n";
+    // fraction of sample pairs (t, t + lag) that are identical
+    unsigned int max_lag = std::min((unsigned int) 10, (unsigned int) state_hashes.size());
+    for (unsigned int lag = 1; lag < max_lag; ++lag)
+    {
+      unsigned int repeats = 0;
+      for (unsigned int t = 0; t + lag < state_hashes.size(); ++t)
+      {
+        if (state_hashes[t] == state_hashes[t + lag]) ++repeats;
+      }
+      std::clog << "# hash_repeat_fraction[" << lag << "]="
+                << float(repeats) / float(state_hashes.size() - lag) << "\n";
+    }
+    std::clog << "Done.\n";
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/// Calls run_chain() with the complex type chosen by run_with_backend().
+struct chain_runner_t
+{
+  const chain_parameters_t & param;
+  const po::variables_map & var_map;
+  const adj_list_t & maximal_facets;
+  const vmap_t & id_to_vertex;
+  unsigned int largest_facet;
+  template <class complex_t>
+  int run() {return run_chain<complex_t>(param, var_map, maximal_facets, id_to_vertex, largest_facet);}
+};
+
+int main(int argc, char const *argv[])
+{
+  /* ~~~~~ Program options ~~~~~~~*/
+  chain_parameters_t param;
   po::options_description description("Options");
   description.add_options()
-  ("burn_in,b", po::value<unsigned int>(&burn_in),
+  ("burn_in,b", po::value<unsigned int>(&param.burn_in),
       "Burn-in time. Defaults to M log M, where M is the sum of degrees.")
-  ("sampling_steps,t", po::value<unsigned int>(&sampling_steps),
+  ("sampling_steps,t", po::value<unsigned int>(&param.sampling_steps),
       "Number of sampling steps.")
-  ("sampling_frequency,f", po::value<unsigned int>(&sampling_frequency),
+  ("sampling_frequency,f", po::value<unsigned int>(&param.sampling_frequency),
       "Number of step between each sample. Defaults to M log M, where M is the sum of degrees.")
-  ("seed,d", po::value<unsigned int>(&seed),
+  ("seed,d", po::value<unsigned int>(&param.seed),
       "Seed of the pseudo random number generator (Mersenne-twister 19937). Seed with time if not specified.")
-  ("l_max,l", po::value<unsigned int>(&L_max),
+  ("l_max,l", po::value<unsigned int>(&param.L_max),
       "Manually set L_max. The correctness of the sampler is not guaranteed if L_max < 2 max s. Defaults to 10% of the sum of facet sizes. ")
   ("exp_prop", "Use exponential proposal distribution.")
   ("pl_prop", "Use power law proposal distribution.")
   ("unif_prop", "Use uniform proposal distribution [default].")
-  ("prop_param", po::value<float>(&prop_param),
+  ("prop_param", po::value<float>(&param.prop_param),
       "Parameter of the proposal distribution (only works for the exponential and power law proposal distributions).")
+  ("delta_log", po::value<std::string>(&param.delta_log_path),
+      "Write the trajectory to this file as a binary delta log (initial state, then accepted moves only) instead of writing samples to the standard output. Read it back with delta_log_reader.")
+  ("keyframe_interval", po::value<unsigned int>(&param.keyframe_interval),
+      "Number of samples between full states in the delta log (0 to disable). Defaults to 100.")
+  ("betti", po::value<unsigned int>(&param.betti_dim),
+      "Compute the Betti numbers b_0, ..., b_D of each sample (over Z/2Z), and output them instead of the samples.")
+  ("comembership_report", po::value<std::string>(&param.report_path),
+      "Accumulate the vertex co-membership counts and the facet overlap histogram of the samples, and write their means, standard deviations and the z-scores of the input complex to this file.")
+  ("threads,j", po::value<unsigned int>(&param.num_threads),
+      "Number of threads used to analyze and validate samples. Defaults to the number of hardware threads.")
+  ("validate", "Check that the input and every sample are simplicial complexes. Violations are listed on the standard error, and the sampler stops with an error.")
   ("cleansed_input,c", "Assume that the input is already cleansed, i.e., that nodes are labeled with 0 indexed contiguous integers and that no facet is included in another.")
-  ("verbose,v", "Output log messages.")
+  ("reorder", po::value<std::string>(&param.reorder),
+      "Relabel vertices and facets internally for cache locality: none [default], degree, or rcm (reverse Cuthill-McKee). Does not affect the output labels.")
+  ("backend", po::value<std::string>(&param.backend),
+      "Storage of the states: adjacency [default], stub, bitset (dense, faster inclusion tests, F x N bits) or auto. auto picks bitset for complexes on at most 2048 vertices whose state fits in the memory of adjacency lists, adjacency otherwise.")
+  ("cache_dir", po::value<std::string>(&param.cache_dir),
+      "Directory where preprocessed facet lists are cached. Later runs on the same input (and with the same -c and --reorder options) load the cache instead of parsing the input.")
+  ("verbose,v", "Output log messages, and mixing diagnostics at the end (numbers of distinct states, and fractions of identical samples at lags 1 to 9, hash_repeat_fraction).")
   ("help,h", "Produce this help message.")
   ;
   po::options_description hidden;
   hidden.add_options()
-  ("facet_list_path", po::value<std::string>(&facet_list_path), 
+  ("facet_list_path", po::value<std::string>(&param.facet_list_path), 
       "Path to facet list.")
   ;
   po::positional_options_description p;
@@ -83,7 +342,7 @@ int main(int argc, char const *argv[])
       return EXIT_FAILURE;
   }
   if (!var_map.count("seed")) {
-      seed = (unsigned int) std::chrono::high_resolution_clock::now().time_since_epoch().count();
+      param.seed = (unsigned int) std::chrono::high_resolution_clock::now().time_since_epoch().count();
   }
 
 
@@ -91,99 +350,50 @@ int main(int argc, char const *argv[])
   /* ~~~~~ Load max. facets ~~~~~~~*/
   if (var_map.count("verbose")) std::clog << "Loading facet file.\n";
   adj_list_t maximal_facets;
-  vmap_t id_to_vertex;
-  std::ifstream file(facet_list_path.c_str());
-  if (!file.is_open()) return EXIT_FAILURE;
-  unsigned int largest_facet = read_facet_list(maximal_facets, file, var_map.count("cleansed_input") != 0, id_to_vertex);
-  file.close();
-
-
-
-  /* ~~~~~ Sampling ~~~~~~~*/
-  scm_t K(maximal_facets);
-  std::mt19937 engine(seed);
-  // prepare proposal distribution
-  if (!var_map.count("l_max")) 
+  std::unique_ptr<input_cache_t> cache;  // must outlive id_to_vertex
+  if (var_map.count("cache_dir"))
   {
-    L_max = std::min(std::max((unsigned int) 0.1 * K.M(), 2 * largest_facet), K.M());
+    std::string options = "reorder=" + param.reorder + (var_map.count("cleansed_input") ? " cleansed" : "");
+    cache.reset(new input_cache_t(param.cache_dir, param.facet_list_path, options));
   }
-  if (L_max < 2 * largest_facet && var_map.count("l_max"))
-  {
-    std::clog << "Warning: Manually set L_max does not guarantee connectivity. ("<< L_max << " < " << 2 * largest_facet << ")\n";
-  }
-  std::vector<double> weights(L_max + 1, 0);
-  if (var_map.count("exp_prop"))
+  vmap_t id_to_vertex;
+  unsigned int largest_facet = 0;
+  if (cache && cache->load(maximal_facets, id_to_vertex, largest_facet))
   {
-    for (unsigned int l = 2; l <= L_max; ++l) weights[l] = exp(l * prop_param);
+    if (var_map.count("verbose")) std::clog << "Loaded cache " << cache->path() << "\n";
   }
-  else if (var_map.count("pl_prop"))
+  else
   {
-    for (unsigned int l = 2; l <= L_max; ++l) weights[l] = pow(l, -prop_param);
-  }
-  else 
-  { // uniform (default)
-    for (unsigned int l = 2; l <= L_max; ++l) weights[l] = 1;
+    std::ifstream file(param.facet_list_path.c_str());
+    if (!file.is_open()) return EXIT_FAILURE;
+    largest_facet = read_facet_list(maximal_facets, file, var_map.count("cleansed_input") != 0, id_to_vertex);
+    file.close();
+    if (!reorder_facet_list(maximal_facets, id_to_vertex, param.reorder))
+    {
+        std::cerr << "Unknown reordering method: " << param.reorder << "\n";
+        return EXIT_FAILURE;
+    }
+    if (cache && !cache->store(maximal_facets, id_to_vertex, largest_facet))
+      std::cerr << "Cannot write cache " << cache->path() << "\n";
   }
-  std::discrete_distribution<> rand_int(weights.begin(), weights.end());
 
 
-  if (!var_map.count("sampling_frequency"))
-  {
-    sampling_frequency = (unsigned int) K.M() * std::log(K.M());
-  }
-  if (!var_map.count("burn_in"))
-  {
-    burn_in = (unsigned int) K.M() * std::log(K.M());
-  }
-  // finally ready to output params (need initialized proposal for that)
-  if (var_map.count("verbose"))
-  {
-    std::clog << "Parameters:\n";
-    std::clog << "\tfacet_list_path: " << facet_list_path << "\n";
-    std::clog << "\tburn_in: " << burn_in << "\n";
-    std::clog << "\tsampling_steps: " << sampling_steps << "\n";
-    std::clog << "\tsampling_frequency: " << sampling_frequency << "\n";
-    std::clog << "\tseed: " << seed << "\n";
-    std::clog << "\tL_max: " << L_max << "\n";
-    std::clog << "\tproposal_distribution: ";
-    if (var_map.count("exp_prop")) {std::clog << "exponential\n";}
-    else if (var_map.count("pl_prop")) {std::clog << "power law\n";}
-    else {std::clog << "uniform\n";}
-    std::clog << "\tprop_param: " << prop_param << "\n";
-    std::clog << "\tcleansed_input: ";
-    if (var_map.count("cleansed_input")) {std::clog << "yes\n";}
-    else {std::clog << " no\n";}
-  }
-  // Burn-in
-  if (var_map.count("verbose")) std::clog << "Burn-in in progress\n";
-  for (unsigned int t = 0; t < burn_in;)
-  {
-    unsigned int l = rand_int(engine);
-    auto moves = K.random_rewire(l, engine);
-    if (K.do_moves(moves)) ++t;
-  }
-  // Sample
-  if (var_map.count("verbose")) std::clog << "Starting sampling\n";  
-  unsigned int accepted = 0;
-  for (unsigned int t = 1; t < sampling_steps * sampling_frequency + 1; ++t)
+
+  /* ~~~~~ Sampling ~~~~~~~*/
+  unsigned int N = 0;
+  unsigned long long M = 0;
+  for (auto & f : maximal_facets)
   {
-    unsigned int l = rand_int(engine);
-    auto moves = K.random_rewire(l, engine);
-    if (K.do_moves(moves))
-    {
-      ++accepted;
-    } 
-    if (t % sampling_frequency == 0)
-    {
-      output_K(K, std::cout, id_to_vertex);
-    }
+    if (!f.empty()) N = std::max(N, *f.rbegin() + 1);
+    M += f.size();
   }
-  float acceptance_ratio = float(accepted) / float(sampling_steps * sampling_frequency);
-  if (var_map.count("verbose"))
+  std::string backend = resolve_backend(param.backend, N, maximal_facets.size(), M);
+  if (backend.empty())
   {
-    std::clog << "# acceptance_ratio=" << acceptance_ratio << "\n";
-    std::clog << "Done.\n";
+      std::cerr << "Unknown backend: " << param.backend << "\n";
+      return EXIT_FAILURE;
   }
-
-  return EXIT_SUCCESS;
+  if (var_map.count("verbose")) std::clog << "Using the " << backend << " backend.\n";
+  chain_runner_t runner{param, var_map, maximal_facets, id_to_vertex, largest_facet};
+  return run_with_backend(backend, N, runner);
 }
@@ -7,31 +7,146 @@
 #include <cstdlib>   // EXIT_FAILURE, EXIT_SUCCESS
 
 #include <iostream>
+#include <memory>  // unique_ptr
 #include <fstream>
 #include <sstream>
 
 #include <chrono>
+#include <algorithm>  // max
+#include <numeric>  // accumulate
 #include <vector>
 #include <utility>
 #include <random>
 #include <string>
+#include <thread>  // hardware_concurrency
 // Boost
 #include <boost/program_options.hpp>    
 // Program headers
 #include "types.h"
 #include "scm/scm.h"
+#include "scm/feasibility.h"
 #include "io_functions.h"
+#include "input_cache.h"
+#include "backend.h"
+#include "thread_pool.h"
 
 namespace po = boost::program_options;
 
+// Exit codes, in addition to EXIT_SUCCESS and EXIT_FAILURE
+const int EXIT_INFEASIBLE = 2;        // sequences are certainly not simplicial
+const int EXIT_BUDGET_EXHAUSTED = 3;  // --max_tries or --time_budget reached
+
+/// Shuffle K until it is a simplicial complex, or until the budget is spent.
+/// A budget of 0 means no limit. Returns true if a complex was found.
+/// Inclusions are looked for with the help of pool, if not null; multi-edges,
+/// which reject most tries, are detected serially in a single pass.
+template <class complex_t>
+bool rejection_sample(complex_t & K, std::mt19937 & engine, thread_pool_t * pool,
+                      unsigned long long max_tries, double time_budget, bool verbose)
+{
+  typedef std::chrono::steady_clock clock_type;
+  clock_type::time_point start = clock_type::now();
+  clock_type::time_point last_report = start;
+  unsigned long long tries = 0;
+  bool found = false;
+  while (!found)
+  {
+    if (max_tries > 0 && tries >= max_tries) break;
+    K.shuffle(engine);
+    found = !K.has_multiedges() && !K.has_inclusions(pool);
+    ++tries;
+    // checking the clock is cheap compared to a try
+    if (verbose || time_budget > 0)
+    {
+      clock_type::time_point now = clock_type::now();
+      double elapsed = std::chrono::duration<double>(now - start).count();
+      if (verbose && std::chrono::duration<double>(now - last_report).count() > 0.2)
+      {
+        std::clog << "\rtries: " << tries << " (" << (unsigned long long) (tries / std::max(elapsed, 1e-9)) << " tries/s)   ";
+        last_report = now;
+      }
+      if (time_budget > 0 && elapsed >= time_budget) break;
+    }
+  }
+  if (verbose)
+  {
+    // final summary, also when the budget is exhausted
+    double elapsed = std::max(std::chrono::duration<double>(clock_type::now() - start).count(), 1e-9);
+    std::clog << "\rtries: " << tries << " (" << (unsigned long long) (tries / elapsed) << " tries/s)"
+              << ", acceptance rate: " << (found ? 1.0 / tries : 0.0) << "\n";
+  }
+  return found;
+}
+
+/// Sample K with the rejection method and output it; returns the exit code.
+template <class complex_t>
+int sample_and_output(complex_t & K, std::mt19937 & engine, thread_pool_t * pool, const vmap_t & id_to_vertex,
+                      unsigned long long max_tries, double time_budget, bool verbose)
+{
+  if (!rejection_sample(K, engine, pool, max_tries, time_budget, verbose))
+  {
+    std::cerr << "Budget exhausted before finding a simplicial complex.\n";
+    return EXIT_BUDGET_EXHAUSTED;
+  }
+  output_K(K, std::cout, id_to_vertex);
+  return EXIT_SUCCESS;
+}
+
+/// Calls sample_and_output() with the complex type chosen by run_with_backend().
+/// K is built from the facet list if there is one, and from (s, d) otherwise.
+/// Tries are checked with num_threads threads, and a facet list is first
+/// validated with them if validate is set.
+struct sampling_runner_t
+{
+  const adj_list_t * maximal_facets;
+  const uint_vec_t * s;
+  const uint_vec_t * d;
+  std::mt19937 & engine;
+  const vmap_t & id_to_vertex;
+  unsigned long long max_tries;
+  double time_budget;
+  bool verbose;
+  unsigned int num_threads;
+  bool validate;
+  template <class complex_t>
+  int run()
+  {
+    std::unique_ptr<complex_t> K(maximal_facets ? new complex_t(*maximal_facets) : new complex_t(*s, *d));
+    // the calling thread takes part in the checks
+    std::unique_ptr<thread_pool_t> pool;
+    if (num_threads > 1) pool.reset(new thread_pool_t(num_threads - 1, num_threads));
+    if (maximal_facets && validate)
+    {
+      if (!validate_complex(*K, pool.get(), "The input", id_to_vertex, std::cerr)) return EXIT_FAILURE;
+      if (verbose) std::clog << "The input is a simplicial complex.\n";
+    }
+    return sample_and_output(*K, engine, pool.get(), id_to_vertex, max_tries, time_budget, verbose);
+  }
+};
+
+/// Resolve the backend for F facets and M incidences on N vertices, and
+/// sample; returns the exit code.
+int sample_with_backend(const std::string & backend, unsigned int N, unsigned int F, unsigned long long M,
+                        sampling_runner_t & runner)
+{
+  std::string resolved = resolve_backend(backend, N, F, M);
+  if (runner.verbose) std::clog << "Using the " << resolved << " backend.\n";
+  return run_with_backend(resolved, N, runner);
+}
+
 int main(int argc, char const *argv[])
 {
   /* ~~~~~ Program options ~~~~~~~*/
   std::string facet_list_path;
+  std::string reorder = "none";
+  std::string cache_dir;
+  std::string backend = "adjacency";
   std::string degree_seq_file;
   std::string size_seq_file;
-  unsigned int num_samples;
   unsigned int seed;
+  unsigned long long max_tries = 0;
+  double time_budget = 0;
+  unsigned int num_threads = std::thread::hardware_concurrency();
 
   po::options_description description("Options");
   description.add_options()
@@ -42,6 +157,19 @@ int main(int argc, char const *argv[])
     "Path to degree sequence file.")
   ("size_seq_file,s", po::value<std::string>(&size_seq_file),
     "Path to size sequence file.")
+  ("backend", po::value<std::string>(&backend),
+    "Storage of the states: adjacency [default], stub (stub lists, faster shuffles), bitset (dense, faster inclusion tests, F x N bits) or auto. auto picks bitset for complexes on at most 2048 vertices whose state fits in the memory of adjacency lists, adjacency otherwise.")
+  ("max_tries", po::value<unsigned long long>(&max_tries),
+    "Give up after this many tries (exit code 3). Unlimited by default.")
+  ("time_budget", po::value<double>(&time_budget),
+    "Give up after this many seconds (exit code 3). Unlimited by default.")
+  ("validate", "In facet list mode, check that the input is a simplicial complex before sampling. Violations are listed on the standard error, and the sampler stops with an error.")
+  ("threads,j", po::value<unsigned int>(&num_threads),
+    "Number of threads used to look for inclusions in each try, and by --validate. Defaults to the number of hardware threads.")
+  ("reorder", po::value<std::string>(&reorder),
+      "Relabel vertices and facets internally for cache locality: none [default], degree, or rcm (reverse Cuthill-McKee). Does not affect the output labels.")
+  ("cache_dir", po::value<std::string>(&cache_dir),
+      "Directory where preprocessed facet lists are cached. Later runs on the same input (and with the same -c and --reorder options) load the cache instead of parsing the input.")
   ("verbose,v", "Output log messages.")
   ("help,h", "Produce help message.")
   ;
@@ -75,6 +203,11 @@ int main(int argc, char const *argv[])
       std::cerr << "Missing facet list or sequences files.\n";
       return EXIT_FAILURE;
   }
+  if (resolve_backend(backend, 0, 0, 0).empty())
+  {
+      std::cerr << "Unknown backend: " << backend << "\n";
+      return EXIT_FAILURE;
+  }
   if (!var_map.count("seed")) {
       // seeding based on the clock
       seed = (unsigned int) std::chrono::high_resolution_clock::now().time_since_epoch().count();
@@ -87,33 +220,45 @@ int main(int argc, char const *argv[])
     /* ~~~~~ Load max. facets ~~~~~~~*/
     if (var_map.count("verbose")) std::clog << "Loading facet file.\n";
     adj_list_t maximal_facets;
+    std::unique_ptr<input_cache_t> cache;  // must outlive id_to_vertex
+    if (var_map.count("cache_dir"))
+    {
+      std::string options = "reorder=" + reorder + (var_map.count("cleansed_input") ? " cleansed" : "");
+      cache.reset(new input_cache_t(cache_dir, facet_list_path, options));
+    }
     vmap_t id_to_vertex;
-    std::ifstream file(facet_list_path.c_str());
-    if (!file.is_open()) return EXIT_FAILURE;
-    unsigned int largest_facet = read_facet_list(maximal_facets, file, var_map.count("cleansed_input") != 0, id_to_vertex);
-    file.close();
-    /* ~~~~~ Sampling ~~~~~~~*/
-    scm_t K(maximal_facets);
-    std::mt19937 engine(seed);
-    if (var_map.count("verbose"))
+    unsigned int largest_facet = 0;
+    if (cache && cache->load(maximal_facets, id_to_vertex, largest_facet))
     {
-      unsigned int tries = 1;
-      do
-      {
-        K.shuffle(engine);
-        std::clog << "\rnum_tries: " << tries;
-        ++tries;
-      } while(!K.is_simplicial_complex());
-      std::clog << "\n";
+      if (var_map.count("verbose")) std::clog << "Loaded cache " << cache->path() << "\n";
     }
     else
     {
-      do
+      std::ifstream file(facet_list_path.c_str());
+      if (!file.is_open()) return EXIT_FAILURE;
+      largest_facet = read_facet_list(maximal_facets, file, var_map.count("cleansed_input") != 0, id_to_vertex);
+      file.close();
+      if (!reorder_facet_list(maximal_facets, id_to_vertex, reorder))
       {
-        K.shuffle(engine);
-      } while(!K.is_simplicial_complex());      
+          std::cerr << "Unknown reordering method: " << reorder << "\n";
+          return EXIT_FAILURE;
+      }
+      if (cache && !cache->store(maximal_facets, id_to_vertex, largest_facet))
+        std::cerr << "Cannot write cache " << cache->path() << "\n";
+    }
+    /* ~~~~~ Sampling ~~~~~~~*/
+    std::mt19937 engine(seed);
+    unsigned int N = 0;
+    unsigned long long M = 0;
+    for (auto & f : maximal_facets)
+    {
+      if (!f.empty()) N = std::max(N, *f.rbegin() + 1);
+      M += f.size();
     }
-    output_K(K, std::cout, id_to_vertex);
+    sampling_runner_t runner{&maximal_facets, nullptr, nullptr, engine, id_to_vertex,
+                             max_tries, time_budget, var_map.count("verbose") != 0,
+                             num_threads, var_map.count("validate") != 0};
+    return sample_with_backend(backend, N, maximal_facets.size(), M, runner);
   }
   else 
   {
@@ -132,28 +277,18 @@ int main(int argc, char const *argv[])
       read_sequence_file(file, s);
       file.close();
     }
-    /* ~~~~~ Sampling ~~~~~~~*/
-    scm_t K(s, d);
-    std::mt19937 engine(seed);
-    if (var_map.count("verbose"))
-    {
-      unsigned int tries = 1;
-      do
-      {
-        K.shuffle(engine);
-        std::clog << "\rnum_tries: " << tries;
-        ++tries;
-      } while(!K.is_simplicial_complex());
-      std::clog << "\n";
-    }
-    else
+    /* ~~~~~ Feasibility ~~~~~~~*/
+    std::string reason;
+    if (!sequences_are_feasible(s, d, reason))
     {
-      do
-      {
-        K.shuffle(engine);
-      } while(!K.is_simplicial_complex());      
+      std::cerr << "Sequences are not simplicial: " << reason << ".\n";
+      return EXIT_INFEASIBLE;
     }
-    output_K(K, std::cout);
+    /* ~~~~~ Sampling ~~~~~~~*/
+    std::mt19937 engine(seed);
+    vmap_t no_labels;
+    sampling_runner_t runner{nullptr, &s, &d, engine, no_labels,
+                             max_tries, time_budget, var_map.count("verbose") != 0, num_threads, false};
+    return sample_with_backend(backend, d.size(), s.size(), std::accumulate(s.begin(), s.end(), 0ULL), runner);
   }
-  return EXIT_SUCCESS;
 }
@@ -0,0 +1,138 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Ensemble statistics of co-membership and facet overlaps, implementation
+#include "comembership.h"
+
+#include <cmath>
+#include <iterator>  // next
+#include <limits>
+
+void moments_t::merge(const moments_t & other)
+{
+  if (other.count == 0) return;
+  double total = (double) count + other.count;
+  double delta = other.average - average;
+  average += delta * other.count / total;
+  m2 += other.m2 + delta * delta * count * other.count / total;
+  count += other.count;
+}
+
+double moments_t::mean(unsigned int n) const
+{
+  return n > 0 ? average * count / n : 0;
+}
+
+double moments_t::sd(unsigned int n) const
+{
+  if (n == 0) return 0;
+  // merge with the n - count zeros
+  moments_t all = *this;
+  moments_t zeros;
+  zeros.count = n - count;
+  all.merge(zeros);
+  return all.m2 > 0 ? std::sqrt(all.m2 / n) : 0;
+}
+
+double moments_t::z_score(double x, unsigned int n) const
+{
+  double s = sd(n);
+  if (s == 0) return std::numeric_limits<double>::quiet_NaN();
+  return (x - mean(n)) / s;
+}
+
+pair_count_t comembership_counts(const adj_list_t & facets)
+{
+  pair_count_t counts;
+  for (const neighborhood_t & f : facets)
+    for (auto u = f.begin(); u != f.end(); ++u)
+      for (auto v = std::next(u); v != f.end(); ++v)
+        ++counts[((vertex_pair_t) *u << 32) | *v];
+  return counts;
+}
+
+std::vector<unsigned long long> overlap_histogram(const adj_list_t & facets, unsigned int max_size)
+{
+  // overlaps are counted through the vertices: each pair of facets that
+  // share a vertex gets one unit per shared vertex.
+  std::vector< std::vector<id_t> > facets_of;
+  for (id_t f = 0; f < facets.size(); ++f)
+  {
+    for (id_t v : facets[f])
+    {
+      if (v >= facets_of.size()) facets_of.resize(v + 1);
+      facets_of[v].push_back(f);
+    }
+  }
+  pair_count_t shared;  // keyed by pairs of facets
+  for (const std::vector<id_t> & fs : facets_of)
+    for (unsigned int a = 0; a < fs.size(); ++a)
+      for (unsigned int b = a + 1; b < fs.size(); ++b)
+        ++shared[((vertex_pair_t) fs[a] << 32) | fs[b]];
+  std::vector<unsigned long long> histogram(max_size + 1, 0);
+  unsigned long long F = facets.size();
+  histogram[0] = F > 0 ? F * (F - 1) / 2 : 0;
+  for (auto & pair : shared)
+  {
+    if (pair.second >= histogram.size()) histogram.resize(pair.second + 1, 0);
+    ++histogram[pair.second];
+    --histogram[0];
+  }
+  return histogram;
+}
+
+
+comembership_accumulator_t::comembership_accumulator_t(unsigned int num_shards, unsigned int max_size)
+  :
+  shards_(num_shards > 0 ? num_shards : 1),
+  next_shard_(0),
+  max_size_(max_size)
+{
+  for (shard_t & shard : shards_)
+  {
+    shard.num_samples = 0;
+    shard.overlap.assign(max_size + 1, moments_t());
+  }
+}
+
+void comembership_accumulator_t::add(const adj_list_t & facets)
+{
+  pair_count_t counts = comembership_counts(facets);
+  std::vector<unsigned long long> histogram = overlap_histogram(facets, max_size_);
+  // first free shard, starting from a different one at each call
+  unsigned int i = next_shard_++ % shards_.size();
+  while (!shards_[i].mutex.try_lock()) i = (i + 1) % shards_.size();
+  shard_t & shard = shards_[i];
+  std::lock_guard<std::mutex> lock(shard.mutex, std::adopt_lock);
+  ++shard.num_samples;
+  if (histogram.size() > shard.overlap.size()) shard.overlap.resize(histogram.size());
+  for (unsigned int k = 0; k < histogram.size(); ++k)
+    shard.overlap[k].add(histogram[k]);
+  for (auto & pair : counts)
+    shard.comembership[pair.first].add(pair.second);
+}
+
+void comembership_accumulator_t::merge()
+{
+  shard_t & total = shards_[0];
+  for (unsigned int i = 1; i < shards_.size(); ++i)
+  {
+    shard_t & shard = shards_[i];
+    total.num_samples += shard.num_samples;
+    if (shard.overlap.size() > total.overlap.size()) total.overlap.resize(shard.overlap.size());
+    for (unsigned int k = 0; k < shard.overlap.size(); ++k)
+      total.overlap[k].merge(shard.overlap[k]);
+    for (auto & pair : shard.comembership)
+      total.comembership[pair.first].merge(pair.second);
+    shard.num_samples = 0;
+    shard.overlap.assign(max_size_ + 1, moments_t());
+    shard.comembership.clear();
+  }
+}
+
+unsigned int comembership_accumulator_t::num_samples() const {return shards_[0].num_samples;}
+
+const std::vector<moments_t> & comembership_accumulator_t::overlap() const {return shards_[0].overlap;}
+
+const std::unordered_map<vertex_pair_t, moments_t> & comembership_accumulator_t::comembership() const
+{
+  return shards_[0].comembership;
+}
@@ -0,0 +1,90 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Ensemble statistics of co-membership and facet overlaps, headers
+#ifndef COMEMBERSHIP_H
+#define COMEMBERSHIP_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "../types.h"
+
+/// Pair of vertices u < v, packed as (u << 32) | v.
+typedef std::uint64_t vertex_pair_t;
+typedef std::unordered_map<vertex_pair_t, unsigned int> pair_count_t;
+
+/// Running mean and variance of an observable over the samples in which it
+/// was observed, with Welford's update. In mean() and sd(), the other
+/// samples, up to n, count as zeros.
+struct moments_t
+{
+  unsigned int count;
+  double average;
+  double m2;  // sum of squared deviations from average
+  moments_t() : count(0), average(0), m2(0) {}
+  void add(double x)
+  {
+    ++count;
+    double delta = x - average;
+    average += delta / count;
+    m2 += delta * (x - average);
+  }
+  /// Combine with the moments of other samples (Chan et al.'s formula).
+  void merge(const moments_t & other);
+  double mean(unsigned int n) const;
+  double sd(unsigned int n) const;
+  /// Standard score of x (NaN if the observable does not fluctuate).
+  double z_score(double x, unsigned int n) const;
+};
+
+/** Number of facets shared by each pair of vertices (absent pairs share 0).
+  * @param[in] <facets> List of facets.
+  */
+pair_count_t comembership_counts(const adj_list_t & facets);
+
+/** Number of pairs of facets that share k vertices, indexed by k.
+  * @param[in] <facets> List of facets.
+  * @param[in] <max_size> Size of the largest facet.
+  */
+std::vector<unsigned long long> overlap_histogram(const adj_list_t & facets, unsigned int max_size);
+
+
+/** @class comembership_accumulator_t
+  * @brief Sparse running means and variances of the vertex co-membership
+  *        counts and of the facet overlap histogram, over samples.
+  *
+  * add() can be called concurrently: the counts of a sample are computed
+  * without locking, then accumulated in one of num_shards shards (the first
+  * one that is free). Shards are combined by merge(), after the last add().
+  */
+class comembership_accumulator_t {
+public:
+  comembership_accumulator_t(unsigned int num_shards, unsigned int max_size);
+
+  void add(const adj_list_t & facets);
+  void merge();
+
+  /** @name Results (valid after merge())
+    */
+  //@{
+  unsigned int num_samples() const;
+  const std::vector<moments_t> & overlap() const;
+  /// Only the pairs that shared a facet in at least one sample.
+  const std::unordered_map<vertex_pair_t, moments_t> & comembership() const;
+  //@}
+
+private:
+  struct shard_t
+  {
+    std::mutex mutex;
+    unsigned int num_samples;
+    std::vector<moments_t> overlap;
+    std::unordered_map<vertex_pair_t, moments_t> comembership;
+  };
+  std::vector<shard_t> shards_;
+  std::atomic<unsigned int> next_shard_;
+  unsigned int max_size_;
+};
+
+#endif // COMEMBERSHIP_H
@@ -0,0 +1,192 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Exact enumeration of small SCM ensembles, implementation
+// Reference: https://doi.org/10.1103/PhysRevE.96.032312
+// arXiv link:  https://arxiv.org/abs/1705.10298
+#include "enumeration.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cassert>
+#include <functional>
+#include <numeric>
+#include <thread>
+
+static inline unsigned int popcount(facet_mask_t x)
+{
+  return std::bitset<64>(x).count();
+}
+
+enumeration_t::enumeration_t(const uint_vec_t & s, const uint_vec_t & d)
+  :
+  s_(s),
+  d_(d),
+  count_(0)
+{
+  assert(d.size() <= 64);
+  // Largest facets first: a facet may then only be included in earlier ones.
+  std::sort(s_.begin(), s_.end(), std::greater<unsigned int>());
+  F_ = s_.size();
+  N_ = d_.size();
+}
+
+enumeration_t::worker_t enumeration_t::new_worker() const
+{
+  worker_t w;
+  w.residual_degrees = d_;
+  w.facets.assign(F_, 0);
+  w.stop = F_;
+  w.count = 0;
+  w.overlap.assign((F_ > 0 ? s_[0] : 0) + 1, 0);
+  w.comembership.assign(N_ * N_, 0);
+  return w;
+}
+
+void enumeration_t::run(unsigned int num_threads, visitor_t visitor)
+{
+  visitor_ = visitor;
+  worker_t root = new_worker();
+  count_ = 0;
+  overlap_ = root.overlap;
+  comembership_ = root.comembership;
+  if (std::accumulate(s_.begin(), s_.end(), 0u) != std::accumulate(d_.begin(), d_.end(), 0u))
+    return;  // empty ensemble
+  if (num_threads == 0) num_threads = 1;
+
+  // Split the search tree: go down until there are enough branches to keep
+  // all threads busy.
+  std::vector<worker_t> branches;
+  unsigned int split_depth = 0;
+  do
+  {
+    ++split_depth;
+    branches.clear();
+    root.stop = std::min(split_depth, F_);
+    search(root, 0, [&branches](worker_t & w) {branches.push_back(w);});
+  } while (branches.size() < 16 * num_threads && split_depth < F_);
+
+  // Explore branches in parallel
+  std::atomic<unsigned int> next_branch(0);
+  std::vector<worker_t> workers(num_threads, new_worker());
+  std::vector<std::thread> threads;
+  leaf_action_t record_leaf = std::bind(&enumeration_t::record, this, std::placeholders::_1);
+  for (unsigned int t = 0; t < num_threads; ++t)
+  {
+    threads.push_back(std::thread([&, t]() {
+      worker_t & w = workers[t];
+      for (unsigned int b = next_branch++; b < branches.size(); b = next_branch++)
+      {
+        w.facets = branches[b].facets;
+        w.residual_degrees = branches[b].residual_degrees;
+        w.stop = F_;
+        search(w, branches[b].stop, record_leaf);
+      }
+    }));
+  }
+  for (auto & th : threads) th.join();
+
+  // Merge
+  for (const worker_t & w : workers)
+  {
+    count_ += w.count;
+    for (unsigned int k = 0; k < overlap_.size(); ++k) overlap_[k] += w.overlap[k];
+    for (unsigned int p = 0; p < comembership_.size(); ++p) comembership_[p] += w.comembership[p];
+  }
+}
+
+void enumeration_t::search(worker_t & w, unsigned int depth, const leaf_action_t & leaf)
+{
+  if (depth == w.stop)
+  {
+    leaf(w);
+    return;
+  }
+  // Degree constraints: a vertex cannot appear more often than there are
+  // facets left, and must be in this facet if it has to be in all of them.
+  unsigned int facets_left = F_ - depth;
+  facet_mask_t forced = 0;
+  uint_vec_t free_vertices;
+  for (id_t v = 0; v < N_; ++v)
+  {
+    unsigned int r = w.residual_degrees[v];
+    if (r > facets_left) return;
+    if (r == facets_left) forced |= (facet_mask_t) 1 << v;
+    else if (r > 0) free_vertices.push_back(v);
+  }
+  unsigned int num_forced = popcount(forced);
+  if (num_forced > s_[depth] || num_forced + free_vertices.size() < s_[depth]) return;
+  choose(w, depth, leaf, free_vertices, 0, s_[depth] - num_forced, forced);
+}
+
+void enumeration_t::choose(worker_t & w, unsigned int depth, const leaf_action_t & leaf,
+                           const uint_vec_t & free_vertices, unsigned int next,
+                           unsigned int k, facet_mask_t mask)
+{
+  if (k == 0)
+  {
+    // Symmetry breaking between facets of equal sizes
+    if (depth > 0 && s_[depth] == s_[depth - 1] && mask <= w.facets[depth - 1])
+      return;
+    // Inclusion in a larger (or equal) facet
+    for (unsigned int j = 0; j < depth; ++j)
+    {
+      if ((mask & ~w.facets[j]) == 0) return;
+    }
+    w.facets[depth] = mask;
+    for (id_t v = 0; v < N_; ++v)
+      if (mask >> v & 1) --w.residual_degrees[v];
+    search(w, depth + 1, leaf);
+    for (id_t v = 0; v < N_; ++v)
+      if (mask >> v & 1) ++w.residual_degrees[v];
+    w.facets[depth] = 0;
+    return;
+  }
+  for (unsigned int i = next; i + k <= free_vertices.size(); ++i)
+  {
+    choose(w, depth, leaf, free_vertices, i + 1, k - 1,
+           mask | (facet_mask_t) 1 << free_vertices[i]);
+  }
+}
+
+void enumeration_t::record(worker_t & w)
+{
+  ++w.count;
+  for (unsigned int a = 0; a < F_; ++a)
+  {
+    for (unsigned int b = a + 1; b < F_; ++b)
+      ++w.overlap[popcount(w.facets[a] & w.facets[b])];
+    for (id_t u = 0; u < N_; ++u)
+    {
+      if (!(w.facets[a] >> u & 1)) continue;
+      for (id_t v = u + 1; v < N_; ++v)
+        if (w.facets[a] >> v & 1) ++w.comembership[u * N_ + v];
+    }
+  }
+  if (visitor_)
+  {
+    std::lock_guard<std::mutex> lock(visitor_mutex_);
+    visitor_(w.facets);
+  }
+}
+
+unsigned long long enumeration_t::num_complexes() const {return count_;}
+
+std::vector<double> enumeration_t::mean_overlap_histogram() const
+{
+  std::vector<double> mean(overlap_.size(), 0);
+  if (count_ == 0) return mean;
+  for (unsigned int k = 0; k < overlap_.size(); ++k)
+    mean[k] = (double) overlap_[k] / (double) count_;
+  return mean;
+}
+
+std::map<edge_t, double> enumeration_t::mean_comembership() const
+{
+  std::map<edge_t, double> mean;
+  if (count_ == 0) return mean;
+  for (id_t u = 0; u < N_; ++u)
+    for (id_t v = u + 1; v < N_; ++v)
+      if (comembership_[u * N_ + v] > 0)
+        mean[edge_t(u, v)] = (double) comembership_[u * N_ + v] / (double) count_;
+  return mean;
+}
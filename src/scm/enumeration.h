@@ -0,0 +1,90 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Exact enumeration of small SCM ensembles, headers
+// Reference: https://doi.org/10.1103/PhysRevE.96.032312
+// arXiv link:  https://arxiv.org/abs/1705.10298
+#ifndef ENUMERATION_H
+#define ENUMERATION_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "../types.h"
+
+/// Facet stored as a bitmask over (at most 64) vertices.
+typedef std::uint64_t facet_mask_t;
+typedef std::vector<facet_mask_t> mask_list_t;
+
+
+/** @class enumeration_t
+  * @brief Exhaustive enumeration of an SCM ensemble.
+  *
+  * Lists every simplicial complex with a given maximal facet size sequence
+  * and degree sequence, and computes exact ensemble averages of the built-in
+  * observables (facet overlap histogram and vertex co-membership).
+  *
+  * Complexes are sets of facets: facets of equal sizes are enumerated in
+  * increasing bitmask order, such that each complex is visited exactly once.
+  * Facets are placed by decreasing size, so a new facet can only be included
+  * in facets placed before it. The search tree is split into independent
+  * branches, explored in parallel.
+  */
+class enumeration_t {
+public:
+  /// Called on each complex; calls are serialized.
+  typedef std::function<void(const mask_list_t &)> visitor_t;
+
+  /** Constructs from a maximal facet size and degree sequence.
+    * @param[in] <s> Facet size sequence.
+    * @param[in] <d> Degree sequence.
+    * @warning Assume that d.size() <= 64 and s[i], d[i] > 0 for all i.
+    */
+  enumeration_t(const uint_vec_t & s, const uint_vec_t & d);
+
+  /// Enumerate all complexes, optionally visiting each one.
+  void run(unsigned int num_threads, visitor_t visitor = visitor_t());
+
+  /** @name Results (valid after run())
+    */
+  //@{
+  unsigned long long num_complexes() const;
+  /// Average number of pairs of facets that share k vertices, indexed by k.
+  std::vector<double> mean_overlap_histogram() const;
+  /// Average number of facets shared by each pair of vertices (u < v).
+  std::map<edge_t, double> mean_comembership() const;
+  //@}
+
+private:
+  /// Per-thread state and accumulators.
+  struct worker_t
+  {
+    uint_vec_t residual_degrees;
+    mask_list_t facets;
+    unsigned int stop;  // depth at which the leaf action is called
+    unsigned long long count;
+    std::vector<unsigned long long> overlap;
+    std::vector<unsigned long long> comembership;
+  };
+  typedef std::function<void(worker_t &)> leaf_action_t;
+
+  uint_vec_t s_;
+  uint_vec_t d_;
+  unsigned int F_;
+  unsigned int N_;
+  visitor_t visitor_;
+  std::mutex visitor_mutex_;
+  // merged results
+  unsigned long long count_;
+  std::vector<unsigned long long> overlap_;
+  std::vector<unsigned long long> comembership_;
+
+  worker_t new_worker() const;
+  void search(worker_t & w, unsigned int depth, const leaf_action_t & leaf);
+  void choose(worker_t & w, unsigned int depth, const leaf_action_t & leaf,
+              const uint_vec_t & free_vertices, unsigned int next,
+              unsigned int k, facet_mask_t mask);
+  void record(worker_t & w);
+};
+
+#endif // ENUMERATION_H
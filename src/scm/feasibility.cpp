@@ -0,0 +1,92 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Necessary conditions on SCM sequences, implementation
+// Reference: https://doi.org/10.1103/PhysRevE.96.032312
+// arXiv link:  https://arxiv.org/abs/1705.10298
+#include "feasibility.h"
+
+#include <algorithm>
+#include <cmath>  // lgamma, exp
+#include <functional>
+#include <sstream>
+
+bool sequences_are_feasible(const uint_vec_t & s, const uint_vec_t & d, std::string & reason)
+{
+  std::ostringstream msg;
+  unsigned int F = s.size();
+  unsigned int N = d.size();
+  if (F == 0 || N == 0)
+  {
+    reason = "empty sequence";
+    return false;
+  }
+  if (std::count(s.begin(), s.end(), 0) > 0 || std::count(d.begin(), d.end(), 0) > 0)
+  {
+    reason = "sequences must be positive";
+    return false;
+  }
+  unsigned long long sum_s = 0, sum_d = 0;
+  for (unsigned int x : s) sum_s += x;
+  for (unsigned int x : d) sum_d += x;
+  if (sum_s != sum_d)
+  {
+    msg << "sum of sizes (" << sum_s << ") differs from sum of degrees (" << sum_d << ")";
+    reason = msg.str();
+    return false;
+  }
+  uint_vec_t sorted_s(s);
+  std::sort(sorted_s.begin(), sorted_s.end(), std::greater<unsigned int>());
+  unsigned int max_d = *std::max_element(d.begin(), d.end());
+  if (sorted_s[0] > N || max_d > F)
+  {
+    reason = "a facet (vertex) is larger than the number of vertices (facets)";
+    return false;
+  }
+
+  // Gale-Ryser: the k largest facets must fit in the vertices, where a
+  // vertex of degree d_v can be used by at most min(d_v, k) of them.
+  uint_vec_t at_least(F + 2, 0);  // at_least[j] = number of vertices with d_v >= j
+  for (unsigned int x : d) ++at_least[x];
+  for (unsigned int j = F; j > 0; --j) at_least[j - 1] += at_least[j];
+  unsigned long long lhs = 0, rhs = 0;
+  for (unsigned int k = 1; k <= F; ++k)
+  {
+    lhs += sorted_s[k - 1];
+    rhs += at_least[k];
+    if (lhs > rhs)
+    {
+      msg << "no bipartite realization without multi-edges (Gale-Ryser fails at k=" << k << ")";
+      reason = msg.str();
+      return false;
+    }
+  }
+
+  // A facet {v} is included in any other facet that contains v.
+  unsigned int s_ones = std::count(s.begin(), s.end(), 1u);
+  unsigned int d_ones = std::count(d.begin(), d.end(), 1u);
+  if (s_ones > d_ones)
+  {
+    msg << "more facets of size 1 (" << s_ones << ") than vertices of degree 1 (" << d_ones << ")";
+    reason = msg.str();
+    return false;
+  }
+
+  // LYM inequality: the facets form an antichain of subsets of the N
+  // vertices, hence sum_k f_k / binom(N, k) <= 1. Binomials are computed
+  // in log space since they overflow quickly.
+  uint_vec_t facets_of_size(N + 1, 0);
+  for (unsigned int x : s) ++facets_of_size[x];
+  double lym = 0;
+  for (unsigned int k = 1; k <= N; ++k)
+  {
+    if (facets_of_size[k] == 0) continue;
+    double log_binom = std::lgamma(N + 1.0) - std::lgamma(k + 1.0) - std::lgamma(N - k + 1.0);
+    lym += facets_of_size[k] * std::exp(-log_binom);
+  }
+  if (lym > 1 + 1e-9)
+  {
+    msg << "not enough vertices for the facets to be maximal (LYM sum = " << lym << " > 1)";
+    reason = msg.str();
+    return false;
+  }
+  return true;
+}
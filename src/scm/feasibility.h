@@ -0,0 +1,28 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Necessary conditions on SCM sequences, headers
+// Reference: https://doi.org/10.1103/PhysRevE.96.032312
+// arXiv link:  https://arxiv.org/abs/1705.10298
+#ifndef FEASIBILITY_H
+#define FEASIBILITY_H
+
+#include <string>
+#include "../types.h"
+
+/** Fast test of necessary conditions for the existence of a simplicial
+  * complex with facet size sequence s and degree sequence d.
+  *
+  * Checks that the sequences are positive and have equal sums, that the
+  * bipartite graph of incidences is realizable without multi-edges
+  * (Gale-Ryser), that facets of size 1 can be matched to vertices of degree
+  * 1, and that there are enough vertices for the facets to form an
+  * antichain (Lubell-Yamamoto-Meshalkin inequality).
+  *
+  * @param[in]  <s> Facet size sequence.
+  * @param[in]  <d> Degree sequence.
+  * @param[out] <reason> Description of the first violated condition, if any.
+  * @return false if the sequences are certainly not simplicial; true does
+  *         not guarantee that they are.
+  */
+bool sequences_are_feasible(const uint_vec_t & s, const uint_vec_t & d, std::string & reason);
+
+#endif // FEASIBILITY_H
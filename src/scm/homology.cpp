@@ -0,0 +1,98 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Simplicial homology (mod 2) of facet lists, implementation
+#include "homology.h"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <set>
+#include <vector>
+
+typedef std::vector<id_t> simplex_t;
+typedef std::vector<unsigned int> column_t;  // sorted row indices
+
+// Add all subsets of size k of a sorted vertex list to a set of simplices.
+static void add_faces(const simplex_t & vertices, unsigned int k, unsigned int next,
+                      simplex_t & current, std::set<simplex_t> & faces)
+{
+  if (current.size() == k)
+  {
+    faces.insert(current);
+    return;
+  }
+  for (unsigned int i = next; i + (k - current.size()) <= vertices.size(); ++i)
+  {
+    current.push_back(vertices[i]);
+    add_faces(vertices, k, i + 1, current, faces);
+    current.pop_back();
+  }
+}
+
+uint_vec_t betti_numbers(const adj_list_t & facets, unsigned int max_dim)
+{
+  unsigned int top = max_dim + 1;
+  // simplices[k] holds the k-simplices, sorted
+  std::vector< std::vector<simplex_t> > simplices(top + 1);
+  {
+    std::vector< std::set<simplex_t> > faces(top + 1);
+    for (const neighborhood_t & f : facets)
+    {
+      // facets are multisets; multi-edges do not create new faces
+      simplex_t vertices(f.begin(), f.end());
+      vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+      simplex_t current;
+      for (unsigned int k = 0; k <= top && k < vertices.size(); ++k)
+        add_faces(vertices, k + 1, 0, current, faces[k]);
+    }
+    for (unsigned int k = 0; k <= top; ++k)
+      simplices[k].assign(faces[k].begin(), faces[k].end());
+  }
+
+  // rank[k] = rank of the boundary map from k-simplices to (k-1)-simplices
+  uint_vec_t rank(top + 2, 0);
+  std::vector<bool> cleared;  // k-simplices that are pivots in dimension k + 1
+  for (unsigned int k = top; k >= 1; --k)
+  {
+    const std::vector<simplex_t> & rows = simplices[k - 1];
+    const std::vector<simplex_t> & cols = simplices[k];
+    if (cleared.size() != cols.size()) cleared.assign(cols.size(), false);
+    std::vector<bool> next_cleared(rows.size(), false);
+    std::vector<int> owner(rows.size(), -1);  // column with a given pivot row
+    std::vector<column_t> reduced(cols.size());
+    column_t tmp;
+    for (unsigned int j = 0; j < cols.size(); ++j)
+    {
+      if (cleared[j]) continue;
+      // boundary of simplex j: drop each vertex in turn
+      column_t & col = reduced[j];
+      for (unsigned int i = 0; i < cols[j].size(); ++i)
+      {
+        simplex_t face(cols[j]);
+        face.erase(face.begin() + i);
+        col.push_back(std::lower_bound(rows.begin(), rows.end(), face) - rows.begin());
+      }
+      std::sort(col.begin(), col.end());
+      // reduce
+      while (!col.empty() && owner[col.back()] >= 0)
+      {
+        const column_t & other = reduced[owner[col.back()]];
+        tmp.clear();
+        std::set_symmetric_difference(col.begin(), col.end(), other.begin(), other.end(),
+                                      std::back_inserter(tmp));
+        col.swap(tmp);
+      }
+      if (!col.empty())
+      {
+        owner[col.back()] = j;
+        next_cleared[col.back()] = true;
+        ++rank[k];
+      }
+    }
+    cleared.swap(next_cleared);
+  }
+
+  uint_vec_t betti(max_dim + 1, 0);
+  for (unsigned int k = 0; k <= max_dim; ++k)
+    betti[k] = simplices[k].size() - rank[k] - rank[k + 1];
+  return betti;
+}
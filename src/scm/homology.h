@@ -0,0 +1,21 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Simplicial homology (mod 2) of facet lists, headers
+#ifndef HOMOLOGY_H
+#define HOMOLOGY_H
+
+#include "../types.h"
+
+/** Betti numbers b_0, ..., b_max_dim over Z/2Z of the simplicial complex
+  * generated by a list of facets.
+  *
+  * Faces are generated up to dimension max_dim + 1, and the boundary
+  * matrices are reduced from the highest dimension down, with clearing:
+  * a k-simplex that is the pivot of a reduced (k+1)-column is known to
+  * reduce to zero, and is skipped.
+  *
+  * @param[in] <facets> List of facets (not necessarily maximal).
+  * @param[in] <max_dim> Largest dimension of interest.
+  */
+uint_vec_t betti_numbers(const adj_list_t & facets, unsigned int max_dim);
+
+#endif // HOMOLOGY_H
@@ -4,22 +4,87 @@
 // arXiv link:  https://arxiv.org/abs/1705.10298
 #include "scm.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include "../thread_pool.h"
+
+// Facets handed out at once to the threads of validate().
+static const unsigned int VALIDATION_CHUNK = 64;
+
+/// Call test(f) for all facets f < F on the calling thread and the threads of
+/// pool, if not null. Returns true if a test returned true; the threads then
+/// stop, unless exhaustive.
+template <typename test_t>
+static bool find_in_parallel(unsigned int F, thread_pool_t * pool, bool exhaustive, const test_t & test)
+{
+  // Shared with the pool tasks, some of which may only start after we return
+  // (e.g., if the pool is busy with the analysis of earlier samples). Those
+  // see done and leave without touching test.
+  struct state_t
+  {
+    std::atomic<bool> found;
+    std::atomic<unsigned int> next;
+    std::mutex mutex;
+    std::condition_variable idle;
+    unsigned int active;
+    bool done;
+  };
+  std::shared_ptr<state_t> state(new state_t);
+  state->found = false;
+  state->next = 0;
+  state->active = 0;
+  state->done = false;
+  auto work = [F, exhaustive, &test](state_t & s) {
+    for (unsigned int begin = s.next.fetch_add(VALIDATION_CHUNK); begin < F;
+         begin = s.next.fetch_add(VALIDATION_CHUNK))
+    {
+      for (id_t f = begin; f < F && f < begin + VALIDATION_CHUNK; ++f)
+      {
+        if (!exhaustive && s.found.load(std::memory_order_relaxed)) return;
+        if (test(f)) s.found = true;
+      }
+    }
+  };
+  if (pool != nullptr && F > VALIDATION_CHUNK)
+  {
+    for (unsigned int t = 0; t < pool->size(); ++t)
+    {
+      pool->submit([state, work]() {
+        {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          if (state->done) return;
+          ++state->active;
+        }
+        work(*state);
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (--state->active == 0) state->idle.notify_all();
+      });
+    }
+  }
+  work(*state);
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->done = true;
+  state->idle.wait(lock, [&state]() {return state->active == 0;});
+  return state->found;
+}
+
 
 //***************************************
 // CONSTRUCTORS
 //***************************************
 
 // Constructor from a maximal facet list
-scm_t::scm_t(const adj_list_t & maximal_facets)
-  :
-  rand_real_(0, 1)
+template <class storage_t>
+basic_scm_t<storage_t>::basic_scm_t(const adj_list_t & maximal_facets)
 {
   // number of facets is known
   F_ = maximal_facets.size();
   // determine number of vertices and matching
   M_ = 0;
   std::set<unsigned int> vertices;
-  for (neighborhood_t f : maximal_facets)
+  for (const neighborhood_t & f : maximal_facets)
   {
       M_ += f.size();
       vertices.insert(f.begin(), f.end());
@@ -27,17 +92,23 @@ scm_t::scm_t(const adj_list_t & maximal_facets)
   N_ = vertices.size();
   vertices.clear();
   // Load
-  facet_neighbors_.resize(F_);
-  vertex_neighbors_.resize(N_);
+  uint_vec_t s(F_, 0);
+  uint_vec_t d(N_, 0);
+  for (unsigned int f = 0; f < F_; ++f)
+  {
+    s[f] = maximal_facets[f].size();
+    for (unsigned int v : maximal_facets[f]) ++d[v];
+  }
+  storage_.init(s, d);
+  reset_hashes();
   for (unsigned int f = 0; f < maximal_facets.size() ; ++f)
     for (unsigned int v :  maximal_facets[f])
       connect(f, v);
 }
 
 // Constructor from size and degree sequences
-scm_t::scm_t(const uint_vec_t & s, const uint_vec_t & d)
-  :
-  rand_real_(0, 1)
+template <class storage_t>
+basic_scm_t<storage_t>::basic_scm_t(const uint_vec_t & s, const uint_vec_t & d)
 {
   F_ = s.size();
   N_ = d.size();
@@ -45,8 +116,8 @@ scm_t::scm_t(const uint_vec_t & s, const uint_vec_t & d)
   M_ = 0;
   for (unsigned int i : s)
     M_ += i;
-  facet_neighbors_.resize(F_);
-  vertex_neighbors_.resize(N_);
+  storage_.init(s, d);
+  reset_hashes();
   for (unsigned int m = 0, f = 0, v = 0, nf(s[0]), nv(d[0]); m < M_; ++ m)
   {
     // loop over matchings (m) and match facets (f) and vertices (v)
@@ -58,24 +129,24 @@ scm_t::scm_t(const uint_vec_t & s, const uint_vec_t & d)
   }
 }
 
-bool scm_t::is_simplicial_complex() const
+template <class storage_t>
+bool basic_scm_t<storage_t>::is_simplicial_complex() const
 {
-  return !has_inclusions() && !has_multiedges();
+  // the multi-edge test is much cheaper than the inclusion test
+  return !has_multiedges() && !has_inclusions();
 }
 
-bool scm_t::has_multiedges() const
+template <class storage_t>
+bool basic_scm_t<storage_t>::has_multiedges() const
 {
-  for (id_t f = 0; f < F_; ++f)
-  {
-    std::set<id_t> tmp(facet_neighbors_[f].begin(), facet_neighbors_[f].end());
-    if (facet_neighbors_[f].size() > tmp.size())
-      return true;
-  }
-  return false;
+  return storage_.has_multiedges();
 }
 
-bool scm_t::has_inclusions() const
+template <class storage_t>
+bool basic_scm_t<storage_t>::has_inclusions(thread_pool_t * pool) const
 {
+  if (pool != nullptr)
+    return find_in_parallel(F_, pool, false, [this](id_t f) {return !all_inclusions_of(f).empty();});
   for (id_t f = 0; f < F_; ++f)
   {
     // inclusion test
@@ -87,57 +158,68 @@ bool scm_t::has_inclusions() const
   return false;
 }
 
-bool scm_t::included_in(id_t facet_a, id_t facet_b) const
+template <class storage_t>
+bool basic_scm_t<storage_t>::validate(thread_pool_t * pool, validation_report_t * report) const
+{
+  if (report == nullptr && pool == nullptr) return is_simplicial_complex();
+  std::mutex report_mutex;
+  // multi-edges first, since the test is much cheaper. has_multiedges() is
+  // not used: it is not thread-safe for all storage policies.
+  bool invalid = find_in_parallel(F_, pool, report != nullptr, [&](id_t f) {
+    if (!storage_.has_multiedge(f)) return false;
+    if (report != nullptr)
+    {
+      std::lock_guard<std::mutex> lock(report_mutex);
+      report->multiedges.push_back(f);
+    }
+    return true;
+  });
+  if (invalid && report == nullptr) return false;
+  invalid |= find_in_parallel(F_, pool, report != nullptr, [&](id_t f) {
+    if (report == nullptr) return !all_inclusions_of(f).empty();
+    neighborhood_t inclusions = all_inclusions_of(f);
+    if (inclusions.empty()) return false;
+    std::lock_guard<std::mutex> lock(report_mutex);
+    for (id_t g : inclusions)
+      report->inclusions.push_back(std::make_pair(f, g));
+    return true;
+  });
+  if (report != nullptr)
+  {
+    std::sort(report->multiedges.begin(), report->multiedges.end());
+    std::sort(report->inclusions.begin(), report->inclusions.end());
+  }
+  return !invalid;
+}
+
+template <class storage_t>
+bool basic_scm_t<storage_t>::included_in(id_t facet_a, id_t facet_b) const
 {
-  // For X to be NOT included in Y means that X is incident on at least one
-  // vertex not in the vertex set of Y. 
-  id_t smallest_facet = facet_a;
-  if (facet_neighbors_[facet_a].size() < facet_neighbors_[facet_b].size())
-    smallest_facet = facet_b;
-  std::multiset<id_t> tmp;
-  std::set_intersection(facet_neighbors_[facet_a].begin(), facet_neighbors_[facet_a].end(),
-                        facet_neighbors_[facet_b].begin(), facet_neighbors_[facet_b].end(),
-                        std::inserter(tmp, tmp.begin()));
-  return tmp == facet_neighbors_[smallest_facet];
+  return storage_.included_in(facet_a, facet_b);
 }
 
-neighborhood_t scm_t::all_inclusions_of(id_t facet) const
+template <class storage_t>
+neighborhood_t basic_scm_t<storage_t>::all_inclusions_of(id_t facet) const
 {
   // Get all the facets in which a facet is included.
-  // X is included in Y means if the vertices of X
-  // are all connected to a facet Y != X.
-  auto v = facet_neighbors_[facet].begin();
-  neighborhood_t candidates = vertex_neighbors_[*v];
-  candidates.erase(facet);
-  for (++v; v != facet_neighbors_[facet].end(); ++v)
-  {
-    std::multiset<id_t> tmp;
-    std::set_intersection(candidates.begin(), candidates.end(),
-                          vertex_neighbors_[*v].begin(), vertex_neighbors_[*v].end(),
-                          std::inserter(tmp, tmp.begin()));
-    candidates = tmp;
-    if (candidates.size() == 0)
-      return candidates;
-  }
-  return candidates;
+  return storage_.all_inclusions_of(facet);
 }
 
 /// MCMC UTILITIES
-edge_list_t scm_t::get_random_edges(unsigned int l, std::mt19937& engine)
+template <class storage_t>
+edge_list_t basic_scm_t<storage_t>::get_random_edges(unsigned int l, std::mt19937& engine)
 {
   // optimized for small number of edges vs. total number of edges
   // otherwise there is a lot of redraws
   std::set<edge_t> edgeset;
   do
   {
-    edge_t e;
-    e.first = preferential_pick(vertex_neighbors_, engine);
-    e.second = uniform_pick(vertex_neighbors_[e.first], engine);
-    edgeset.insert(e);
+    edgeset.insert(storage_.random_incidence(engine));
   } while (edgeset.size() < l);
   return edge_list_t(edgeset.begin(), edgeset.end());
 }
-edge_list_t scm_t::rewired_edge_list(edge_list_t edgelist, std::mt19937& engine)
+template <class storage_t>
+edge_list_t basic_scm_t<storage_t>::rewired_edge_list(edge_list_t edgelist, std::mt19937& engine)
 {
   edge_list_t new_edgelist(edgelist.begin(), edgelist.end());
   std::shuffle(new_edgelist.begin(), new_edgelist.end(), engine);
@@ -147,7 +229,8 @@ edge_list_t scm_t::rewired_edge_list(edge_list_t edgelist, std::mt19937& engine)
   }
   return new_edgelist;
 }
-std::vector<mcmc_move_t> scm_t::random_rewire(unsigned int l, std::mt19937& engine)
+template <class storage_t>
+std::vector<mcmc_move_t> basic_scm_t<storage_t>::random_rewire(unsigned int l, std::mt19937& engine)
 {
   std::vector<mcmc_move_t> moves(2 * l);
   edge_list_t edges_to_detach = get_random_edges(l, engine);
@@ -163,7 +246,8 @@ std::vector<mcmc_move_t> scm_t::random_rewire(unsigned int l, std::mt19937& engi
   }
   return moves;
 }
-void scm_t::apply_mcmc_moves(std::vector<mcmc_move_t> moves)
+template <class storage_t>
+void basic_scm_t<storage_t>::apply_mcmc_moves(std::vector<mcmc_move_t> moves)
 {
   for (mcmc_move_t move : moves)
   {
@@ -172,146 +256,205 @@ void scm_t::apply_mcmc_moves(std::vector<mcmc_move_t> moves)
   }
   return;
 }
-void scm_t::revert_mcmc_moves(std::vector<mcmc_move_t> moves)
+template <class storage_t>
+void basic_scm_t<storage_t>::revert_mcmc_moves(std::vector<mcmc_move_t> moves)
 {
-  for (mcmc_move_t move : moves)
+  // undo in reverse order, such that facets never exceed their size
+  for (auto move = moves.rbegin(); move != moves.rend(); ++move)
   {
-    if (!move.attach) connect(move.facet, move.vertex);
-    else disconnect(move.facet, move.vertex);
+    if (!move->attach) connect(move->facet, move->vertex);
+    else disconnect(move->facet, move->vertex);
   }
   return;
 }
-bool scm_t::is_the_difference(const neighborhood_t & facet_a, const neighborhood_t & facet_b, std::multiset<id_t> difference) const
-{
-  std::multiset<id_t> tmp;
-  std::set_difference(facet_a.begin(), facet_a.end(), facet_b.begin(), facet_b.end(), std::inserter(tmp, tmp.begin()));
-  return tmp == difference;
-}
-bool scm_t::do_moves(std::vector<mcmc_move_t> moves)
+template <class storage_t>
+bool basic_scm_t<storage_t>::do_moves(std::vector<mcmc_move_t> moves)
 {
   // First apply the move, then verify if it preserves s.
   // if not, revert them ove and return false.
   // if it is, leave the complex as is, and return true.
+#ifndef NDEBUG
+  hash_t initial_hash = state_hash_;
+#endif
   apply_mcmc_moves(moves);
   // Check for s-conservation
   std::set<id_t> facets_to_check;
   for (mcmc_move_t m: moves)
   {
     facets_to_check.insert(m.facet);
-    for (id_t f: vertex_neighbors_[m.vertex])
-    {
-      facets_to_check.insert(f);
-    }
+    storage_.for_each_facet_of(m.vertex, [&facets_to_check](id_t f) {facets_to_check.insert(f);});
   }
 
   for (id_t f: facets_to_check)
   {
     // Test for multi-memberships and inclusion
-    std::set<id_t> tmp(facet_neighbors_[f].begin(), facet_neighbors_[f].end());
     // Important:
     // The left operand first is evaluated first, and the right operand is only evaluted
     // if the first one is false;  all_inclusions_of is much more expensive than the first test.
-    if (facet_neighbors_[f].size() != tmp.size() || all_inclusions_of(f).size() > 0)
+    if (storage_.has_multiedge(f) || all_inclusions_of(f).size() > 0)
     {
       revert_mcmc_moves(moves);
+      assert(state_hash_ == initial_hash);
       return false;
     }
   }
   return true;
 }
-void scm_t::shuffle(std::mt19937& engine)
+template <class storage_t>
+bool basic_scm_t<storage_t>::do_double_swap(std::mt19937& engine, std::array<mcmc_move_t, 4>& moves)
 {
-  // inefficient implementation whereby we construct stub lists,
-  // shuffle one, and reconnect everything.
-  uint_vec_t facet_stubs(M_, 0);
-  uint_vec_t vertex_stubs(M_, 0);
-  unsigned int m = 0;
-  for (id_t f = 0; f < facet_neighbors_.size(); ++f)
-  {
-    for (auto neighbor: facet_neighbors_[f])
-    {
-      facet_stubs[m] = f;
-      ++m;
-    }
-  }
-  m = 0;
-  for (id_t v = 0; v < vertex_neighbors_.size(); ++v)
+  // Same proposal as random_rewire(2, engine) followed by do_moves(), without
+  // the general machinery. Assumes that the current state is a simplicial
+  // complex, such that only the two modified facets need to be checked.
+  edge_t e1 = storage_.random_incidence(engine);
+  edge_t e2;
+  do {e2 = storage_.random_incidence(engine);} while (e2 == e1);
+  id_t v1 = e1.first, f1 = e1.second;
+  id_t v2 = e2.first, f2 = e2.second;
+  // the rewired edges are a random permutation of the facets
+  std::uniform_int_distribution<unsigned int> coin(0, 1);
+  bool swap = coin(engine) == 1;
+  moves[0] = {v1, f1, false};
+  moves[1] = {v2, f2, false};
+  moves[2] = {v1, swap ? f2 : f1, true};
+  moves[3] = {v2, swap ? f1 : f2, true};
+  if (!swap || f1 == f2 || v1 == v2) return true;  // identity
+  // multi-edges: v2 already in f1 or v1 already in f2
+  if (storage_.contains(f1, v2) || storage_.contains(f2, v1))
+    return false;
+#ifndef NDEBUG
+  hash_t initial_hash = state_hash_;
+#endif
+  disconnect(f1, v1);
+  disconnect(f2, v2);
+  connect(f2, v1);
+  connect(f1, v2);
+  // inclusions: a modified facet can only be included in, or include,
+  // facets that share the vertex it gained.
+  auto nested = [this](id_t facet, id_t gained) -> bool {
+    bool found = false;
+    storage_.for_each_facet_of(gained, [&](id_t g) {
+      if (found || g == facet) return;
+      found = storage_.included_in(facet, g) || storage_.included_in(g, facet);
+    });
+    return found;
+  };
+  if (nested(f1, v2) || nested(f2, v1))
   {
-    for (auto neighbor: vertex_neighbors_[v])
-    {
-      vertex_stubs[m] = v;
-      ++m;
-    }
-  }
-  disconnect_all();
-  std::shuffle(vertex_stubs.begin(), vertex_stubs.end(), engine);
-  for (m = 0; m < M_; ++m)
-  {
-    connect(facet_stubs[m], vertex_stubs[m]);
+    disconnect(f1, v2);
+    disconnect(f2, v1);
+    connect(f2, v2);
+    connect(f1, v1);
+    assert(state_hash_ == initial_hash);
+    return false;
   }
+  return true;
+}
+template <class storage_t>
+void basic_scm_t<storage_t>::shuffle(std::mt19937& engine)
+{
+  storage_.shuffle(engine);
+  recompute_hashes();
 }
 
 // SET accessors
-void scm_t::connect(id_t facet, id_t vertex)
+template <class storage_t>
+void basic_scm_t<storage_t>::connect(id_t facet, id_t vertex)
 {
-  facet_neighbors_[facet].insert(vertex);
-  vertex_neighbors_[vertex].insert(facet);
+  storage_.connect(facet, vertex);
+  state_hash_ += incidence_key(facet, vertex);
+  canonical_hash_ -= mix_hash(facet_hash_[facet]);
+  facet_hash_[facet] += vertex_key(vertex);
+  canonical_hash_ += mix_hash(facet_hash_[facet]);
 }
 
-void scm_t::disconnect(id_t facet, id_t vertex)
+template <class storage_t>
+void basic_scm_t<storage_t>::disconnect(id_t facet, id_t vertex)
 {
-  assert(facet_neighbors_[facet].count(vertex) > 0);
-  assert(vertex_neighbors_[vertex].count(facet) > 0);
-  auto itv = facet_neighbors_[facet].find(vertex);
-  auto itf = vertex_neighbors_[vertex].find(facet);
-  facet_neighbors_[facet].erase(itv);
-  vertex_neighbors_[vertex].erase(itf);
+  storage_.disconnect(facet, vertex);
+  state_hash_ -= incidence_key(facet, vertex);
+  canonical_hash_ -= mix_hash(facet_hash_[facet]);
+  facet_hash_[facet] -= vertex_key(vertex);
+  canonical_hash_ += mix_hash(facet_hash_[facet]);
 }
 
-void scm_t::disconnect_all()
+template <class storage_t>
+void basic_scm_t<storage_t>::disconnect_all()
 {
-  facet_neighbors_.clear();
-  facet_neighbors_.resize(F_);
-  vertex_neighbors_.clear();
-  vertex_neighbors_.resize(N_);
+  storage_.disconnect_all();
+  reset_hashes();
 }
 
 // GET accessors
-neighborhood_t scm_t::facet_neighbors(id_t facet) const {return facet_neighbors_[facet];}
-neighborhood_t scm_t::vertex_neighbors(id_t vertex) const {return vertex_neighbors_[vertex];}
-unsigned int scm_t::size(id_t facet) const {return facet_neighbors_[facet].size();}
-unsigned int scm_t::degree(id_t vertex) const {return vertex_neighbors_[vertex].size();}
-unsigned int scm_t::F() const {return F_;}
-unsigned int scm_t::N() const {return N_;}
-unsigned int scm_t::M() const {return M_;}
+template <class storage_t>
+const neighborhood_t & basic_scm_t<storage_t>::facet_neighbors(id_t facet) const {return storage_.facet_neighbors(facet);}
+template <class storage_t>
+const neighborhood_t & basic_scm_t<storage_t>::vertex_neighbors(id_t vertex) const {return storage_.vertex_neighbors(vertex);}
+template <class storage_t>
+unsigned int basic_scm_t<storage_t>::size(id_t facet) const {return storage_.size(facet);}
+template <class storage_t>
+unsigned int basic_scm_t<storage_t>::degree(id_t vertex) const {return storage_.degree(vertex);}
+template <class storage_t>
+unsigned int basic_scm_t<storage_t>::F() const {return F_;}
+template <class storage_t>
+unsigned int basic_scm_t<storage_t>::N() const {return N_;}
+template <class storage_t>
+unsigned int basic_scm_t<storage_t>::M() const {return M_;}
+template <class storage_t>
+hash_t basic_scm_t<storage_t>::state_hash() const {return state_hash_;}
+template <class storage_t>
+hash_t basic_scm_t<storage_t>::canonical_hash() const {return canonical_hash_;}
 
 
-// RNG-related.
-id_t scm_t::preferential_pick(std::vector< std::multiset<id_t> > & vec_of_multiset, std::mt19937& engine) {
-  /* declarations */
-  id_t pick = 0;
-  id_t local_count = 0;
-  id_t global_count = 0;
-  /* choose target "ticket" (# of ticket for node i prop. to. vec_of_multiset[i].size() */
-  id_t target_idx = (id_t) ceil(rand_real_(engine)*(double) M_);
-  /* find the node to which the ticket belongs */
-  do {
-    if (local_count == vec_of_multiset[pick].size()) {
-      local_count = 0;
-      ++pick;
-    }
-    else {
-      ++global_count;
-      ++local_count;
-    }
-  } while (global_count!=target_idx);
-  return pick;
+// Hashing.
+// Incidences are combined by addition (mod 2^64) rather than XOR, such that
+// multi-edges do not cancel out and disconnect() exactly undoes connect().
+// Keys are derived from the ids with mix_hash() instead of being
+// stored in a table, which keeps the memory footprint independent of F x N.
+template <class storage_t>
+void basic_scm_t<storage_t>::reset_hashes()
+{
+  // hash of the empty complex
+  facet_hash_.assign(F_, 0);
+  state_hash_ = 0;
+  canonical_hash_ = (hash_t) F_ * mix_hash(0);
+}
+
+template <class storage_t>
+void basic_scm_t<storage_t>::recompute_hashes()
+{
+  // after bulk modifications of the storage
+  reset_hashes();
+  storage_.for_each_incidence([this](id_t facet, id_t vertex) {
+    state_hash_ += incidence_key(facet, vertex);
+    facet_hash_[facet] += vertex_key(vertex);
+  });
+  canonical_hash_ = 0;
+  for (hash_t h : facet_hash_) canonical_hash_ += mix_hash(h);
 }
 
-id_t scm_t::uniform_pick(const std::multiset<id_t> & a_set, std::mt19937& engine)  {
-  // safe, since rand_real_(0,1) excludes 1.
-  id_t target_idx = (id_t) floor(rand_real_(engine) * (double) a_set.size());
-  auto it = a_set.begin();
-  std::advance(it, target_idx);
-  return *it;
+template <class storage_t>
+hash_t basic_scm_t<storage_t>::incidence_key(id_t facet, id_t vertex)
+{
+  return mix_hash(((hash_t) facet << 32) ^ (hash_t) vertex);
 }
+
+template <class storage_t>
+hash_t basic_scm_t<storage_t>::vertex_key(id_t vertex)
+{
+  // distinct stream from incidence_key
+  return mix_hash((hash_t) vertex ^ 0x5bd1e9955bd1e995ULL);
+}
+
+
+// Explicit instantiation of the available storage policies
+template class basic_scm_t<adjacency_storage_t>;
+template class basic_scm_t<stub_list_storage_t>;
+template class basic_scm_t< bitset_storage_t< std::bitset<64> > >;
+template class basic_scm_t< bitset_storage_t< std::bitset<128> > >;
+template class basic_scm_t< bitset_storage_t< std::bitset<256> > >;
+template class basic_scm_t< bitset_storage_t< std::bitset<512> > >;
+template class basic_scm_t< bitset_storage_t< std::bitset<1024> > >;
+template class basic_scm_t< bitset_storage_t< std::bitset<2048> > >;
+template class basic_scm_t< bitset_storage_t< std::bitset<4096> > >;
+template class basic_scm_t< bitset_storage_t< boost::dynamic_bitset<> > >;
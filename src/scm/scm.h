@@ -8,14 +8,29 @@
 #include <iostream>
 
 #include <algorithm>
+#include <array>
 #include <random>
 #include <set>
+#include <utility>
 #include <vector>
 #include <cassert>
 #include "../types.h"
+#include "scm_adjacency_impl.h"
+#include "scm_stub_list_impl.h"
+#include "scm_bitset_impl.h"
 
+class thread_pool_t;
 
-/** @class scm_t
+/// Violations found by basic_scm_t::validate(), in increasing order.
+struct validation_report_t
+{
+  /// Facets with a repeated vertex.
+  std::vector<id_t> multiedges;
+  /// Pairs (a, b) of distinct facets such that a is included in b.
+  std::vector< std::pair<id_t, id_t> > inclusions;
+};
+
+/** @class basic_scm_t
   * @brief Simplicial configuration model.
   *
   * This class implements the simplicial configuration model (SCM) ensemble.
@@ -23,12 +38,20 @@
   * sequence and a degree sequence. They are maximally random
   * with respect to everything else.
   * 
-  * States are internally represented by two adjacency lists, one for vertices
-  * and one for maximal facets. We also provide an alternative representation
-  * where the states is stored explicitly as two aligned list of stubs,
-  * see scm_stub_list_impl.h.
+  * The representation of states is chosen at compile time with the
+  * storage_t policy. By default (scm_t), states are represented by two
+  * adjacency lists, one for vertices and one for maximal facets, see
+  * scm_adjacency_impl.h. We also provide an alternative representation
+  * (scm_stub_t) where the states is stored explicitly as two aligned list of
+  * stubs, see scm_stub_list_impl.h, and a dense representation (scm_bitset_t)
+  * for complexes on few vertices, see scm_bitset_impl.h.
+  *
+  * Each state also carries two 64-bit Zobrist-style hashes, updated in O(1)
+  * by connect() and disconnect(): state_hash() identifies the exact
+  * incidence set, while canonical_hash() is invariant to facet relabeling.
   */
-class scm_t {
+template <class storage_t>
+class basic_scm_t {
 public:
   /** @name Constructors.
     * Available constructors for the scmt_t class.
@@ -37,7 +60,7 @@ public:
   /** Constructs from a list of maximal facets.
     * @param[in] <maximal_facets> List of maximal facets, in any ordering.
     */
-  scm_t(const adj_list_t & maximal_facets);
+  basic_scm_t(const adj_list_t & maximal_facets);
   /** Constructs from a maximal facet size and  degree sequence.
     * @param[in] <s> Facet size sequence.
     * @param[in] <d> Degree sequence.
@@ -45,7 +68,7 @@ public:
     * @warning The resulting matching will not be sequence-preserving in most cases;
     *          requires some shuffling until a sequence-preserving state is reached.
     */
-  scm_t(const uint_vec_t & s, const uint_vec_t & d);
+  basic_scm_t(const uint_vec_t & s, const uint_vec_t & d);
   //@}
 
 
@@ -55,9 +78,16 @@ public:
   //@{
   bool is_simplicial_complex() const;
   bool has_multiedges() const;
-  bool has_inclusions() const;
+  /// The facets are split between the calling thread and pool, if not null.
+  bool has_inclusions(thread_pool_t * pool = nullptr) const;
   bool included_in(id_t facet_a, id_t facet_b) const; 
   neighborhood_t all_inclusions_of(id_t facet) const;
+  /** Parallel version of is_simplicial_complex().
+    * Facets are split between the calling thread and the threads of pool
+    * (if not null), which all stop at the first violation. If report is not
+    * null, all the violations are listed in it instead.
+    */
+  bool validate(thread_pool_t * pool, validation_report_t * report = nullptr) const;
   //@}
 
   /** @name MCMC utilities
@@ -70,6 +100,8 @@ public:
   bool do_moves(std::vector<mcmc_move_t> moves);
   void apply_mcmc_moves(std::vector<mcmc_move_t> moves);
   void revert_mcmc_moves(std::vector<mcmc_move_t> moves);
+  /// Propose and act on a l=2 move, i.e., a swap of two incidences.
+  bool do_double_swap(std::mt19937& engine, std::array<mcmc_move_t, 4>& moves);
   /// Get a random matching, not necessarily sequence-preserving.
   void shuffle(std::mt19937& engine);
   //@}
@@ -82,32 +114,46 @@ public:
   void disconnect(id_t facet, id_t vertex);
   void disconnect_all();
   // GET accessors
-  neighborhood_t facet_neighbors(id_t facet) const;
-  neighborhood_t vertex_neighbors(id_t vertex) const;
+  const neighborhood_t & facet_neighbors(id_t facet) const;
+  const neighborhood_t & vertex_neighbors(id_t vertex) const;
   unsigned int size(id_t facet) const;
   unsigned int degree(id_t vertex) const;
   unsigned int F() const;
   unsigned int N() const;
   unsigned int M() const;
+  hash_t state_hash() const;
+  hash_t canonical_hash() const;
   //@}
 
 private:
   /// State variable
   // Structure
-  adj_list_t facet_neighbors_;
-  adj_list_t vertex_neighbors_;
+  storage_t storage_;
   // Number of faces, vertices, and matchings
   unsigned int F_;
   unsigned int N_;
   unsigned int M_;
-  /// Internal distribution.
-  std::uniform_real_distribution<double> rand_real_;
+  // Hashes of the state, see state_hash() and canonical_hash()
+  hash_t state_hash_;
+  hash_t canonical_hash_;
+  std::vector<hash_t> facet_hash_;
   /// Private functions
-  bool is_the_difference(const neighborhood_t & facet_a, const neighborhood_t & facet_b, std::multiset<id_t> difference) const;
-  id_t preferential_pick(std::vector< std::multiset<id_t> > & vec_of_multiset, std::mt19937& engine);
-  id_t uniform_pick(const std::multiset<id_t> & a_set, std::mt19937& engine);
   edge_list_t get_random_edges(unsigned int l, std::mt19937& engine);
   edge_list_t rewired_edge_list(edge_list_t edgelist, std::mt19937& engine);
+  void reset_hashes();
+  void recompute_hashes();
+  static hash_t incidence_key(id_t facet, id_t vertex);
+  static hash_t vertex_key(id_t vertex);
 };
 
+/// Adjacency list representation [default].
+typedef basic_scm_t<adjacency_storage_t> scm_t;
+/// Stub list representation.
+typedef basic_scm_t<stub_list_storage_t> scm_stub_t;
+/// Dense representation, for complexes on at most W vertices.
+template <std::size_t W>
+using scm_bitset_t = basic_scm_t< bitset_storage_t< std::bitset<W> > >;
+/// Dense representation, for any number of vertices.
+typedef basic_scm_t< bitset_storage_t< boost::dynamic_bitset<> > > scm_dynamic_bitset_t;
+
 #endif // SCM_H
\ No newline at end of file
@@ -0,0 +1,158 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Adjacency list storage policy for the simplicial configuration model
+// Reference: https://doi.org/10.1103/PhysRevE.96.032312
+// arXiv link:  https://arxiv.org/abs/1705.10298
+#ifndef SCM_ADJACENCY_IMPL_H
+#define SCM_ADJACENCY_IMPL_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iterator>
+#include <random>
+#include <vector>
+#include "../types.h"
+#include "scm_inclusions.h"
+
+
+/** @class adjacency_storage_t
+  * @brief Stores states as two adjacency lists, one for vertices and one for
+  *        maximal facets [default storage policy of scm_t].
+  *
+  * Every modification is O(log) and keeps both lists up to date, which is
+  * well suited to MCMC moves.
+  */
+class adjacency_storage_t {
+public:
+  adjacency_storage_t() : rand_real_(0, 1), M_(0) {}
+
+  /// Empty state with F = s.size() facets and N = d.size() vertices.
+  void init(const uint_vec_t & s, const uint_vec_t & d)
+  {
+    M_ = 0;
+    for (unsigned int x : s) M_ += x;
+    facet_neighbors_.assign(s.size(), neighborhood_t());
+    vertex_neighbors_.assign(d.size(), neighborhood_t());
+  }
+
+  // SET
+  void connect(id_t facet, id_t vertex)
+  {
+    facet_neighbors_[facet].insert(vertex);
+    vertex_neighbors_[vertex].insert(facet);
+  }
+  void disconnect(id_t facet, id_t vertex)
+  {
+    assert(facet_neighbors_[facet].count(vertex) > 0);
+    assert(vertex_neighbors_[vertex].count(facet) > 0);
+    auto itv = facet_neighbors_[facet].find(vertex);
+    auto itf = vertex_neighbors_[vertex].find(facet);
+    facet_neighbors_[facet].erase(itv);
+    vertex_neighbors_[vertex].erase(itf);
+  }
+  void disconnect_all()
+  {
+    for (auto & n : facet_neighbors_) n.clear();
+    for (auto & n : vertex_neighbors_) n.clear();
+  }
+  /// Random matching with the same sizes and degrees.
+  void shuffle(std::mt19937 & engine)
+  {
+    // inefficient implementation whereby we construct stub lists,
+    // shuffle one, and reconnect everything.
+    uint_vec_t facet_stubs;
+    uint_vec_t vertex_stubs;
+    facet_stubs.reserve(M_);
+    vertex_stubs.reserve(M_);
+    for (id_t f = 0; f < facet_neighbors_.size(); ++f)
+      facet_stubs.insert(facet_stubs.end(), facet_neighbors_[f].size(), f);
+    for (id_t v = 0; v < vertex_neighbors_.size(); ++v)
+      vertex_stubs.insert(vertex_stubs.end(), vertex_neighbors_[v].size(), v);
+    disconnect_all();
+    std::shuffle(vertex_stubs.begin(), vertex_stubs.end(), engine);
+    for (unsigned int m = 0; m < facet_stubs.size(); ++m)
+      connect(facet_stubs[m], vertex_stubs[m]);
+  }
+
+  // GET
+  const neighborhood_t & facet_neighbors(id_t facet) const {return facet_neighbors_[facet];}
+  const neighborhood_t & vertex_neighbors(id_t vertex) const {return vertex_neighbors_[vertex];}
+  unsigned int size(id_t facet) const {return facet_neighbors_[facet].size();}
+  unsigned int degree(id_t vertex) const {return vertex_neighbors_[vertex].size();}
+  bool contains(id_t facet, id_t vertex) const {return facet_neighbors_[facet].count(vertex) > 0;}
+  bool has_multiedge(id_t facet) const
+  {
+    // neighborhoods are sorted: repeated vertices are adjacent
+    const neighborhood_t & n = facet_neighbors_[facet];
+    return std::adjacent_find(n.begin(), n.end()) != n.end();
+  }
+  bool has_multiedges() const
+  {
+    for (id_t f = 0; f < facet_neighbors_.size(); ++f)
+      if (has_multiedge(f)) return true;
+    return false;
+  }
+  bool included_in(id_t facet_a, id_t facet_b) const {return neighborhood_included_in(*this, facet_a, facet_b);}
+  neighborhood_t all_inclusions_of(id_t facet) const {return neighborhood_inclusions_of(*this, facet);}
+  /// Call fn(facet) on each facet of a vertex, once per incidence.
+  template <typename function_t>
+  void for_each_facet_of(id_t vertex, function_t fn) const
+  {
+    for (id_t f : vertex_neighbors_[vertex]) fn(f);
+  }
+  /// Call fn(facet, vertex) on each incidence.
+  template <typename function_t>
+  void for_each_incidence(function_t fn) const
+  {
+    for (id_t f = 0; f < facet_neighbors_.size(); ++f)
+      for (id_t v : facet_neighbors_[f]) fn(f, v);
+  }
+  /// Uniformly random incidence, as (vertex, facet).
+  edge_t random_incidence(std::mt19937 & engine)
+  {
+    edge_t e;
+    e.first = preferential_pick(engine);
+    e.second = uniform_pick(vertex_neighbors_[e.first], engine);
+    return e;
+  }
+
+private:
+  adj_list_t facet_neighbors_;
+  adj_list_t vertex_neighbors_;
+  std::uniform_real_distribution<double> rand_real_;
+  unsigned int M_;
+
+  // Vertex chosen with probability proportional to its degree.
+  id_t preferential_pick(std::mt19937 & engine)
+  {
+    /* declarations */
+    id_t pick = 0;
+    id_t local_count = 0;
+    id_t global_count = 0;
+    /* choose target "ticket" (# of ticket for node i prop. to. vertex_neighbors_[i].size() */
+    id_t target_idx = (id_t) ceil(rand_real_(engine) * (double) M_);
+    /* find the node to which the ticket belongs */
+    do {
+      if (local_count == vertex_neighbors_[pick].size()) {
+        local_count = 0;
+        ++pick;
+      }
+      else {
+        ++global_count;
+        ++local_count;
+      }
+    } while (global_count != target_idx);
+    return pick;
+  }
+
+  id_t uniform_pick(const neighborhood_t & a_set, std::mt19937 & engine)
+  {
+    // safe, since rand_real_(0,1) excludes 1.
+    id_t target_idx = (id_t) floor(rand_real_(engine) * (double) a_set.size());
+    auto it = a_set.begin();
+    std::advance(it, target_idx);
+    return *it;
+  }
+};
+
+#endif // SCM_ADJACENCY_IMPL_H
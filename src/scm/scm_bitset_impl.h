@@ -0,0 +1,154 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Dense (bitset) storage policy for the simplicial configuration model
+// Reference: https://doi.org/10.1103/PhysRevE.96.032312
+// arXiv link:  https://arxiv.org/abs/1705.10298
+#ifndef SCM_BITSET_IMPL_H
+#define SCM_BITSET_IMPL_H
+
+#include <atomic>
+#include <bitset>
+#include <cassert>
+#include <mutex>
+#include <random>
+#include <vector>
+#include <boost/dynamic_bitset.hpp>
+#include "../types.h"
+#include "scm_stub_list_impl.h"
+
+// Operations on the bitsets of facets, for fixed and dynamic widths.
+template <std::size_t W>
+inline void resize_bitset(std::bitset<W> &, std::size_t n) {assert(n <= W); (void) n;}
+inline void resize_bitset(boost::dynamic_bitset<> & bits, std::size_t n) {bits.resize(n);}
+template <std::size_t W>
+inline bool is_subset(const std::bitset<W> & a, const std::bitset<W> & b) {return (a & ~b).none();}
+inline bool is_subset(const boost::dynamic_bitset<> & a, const boost::dynamic_bitset<> & b) {return a.is_subset_of(b);}
+
+
+/** @class bitset_storage_t
+  * @brief Stub lists, plus one bitset over the vertices per facet.
+  *
+  * Meant for dense complexes with few vertices: inclusion tests become a
+  * few word-wide AND operations, and a facet has a multi-edge if and only
+  * if its size differs from the number of bits set. The stub lists are kept
+  * for shuffles and random incidences, and mirrored by per-vertex lists of
+  * facets, which give the candidates of inclusion tests without the
+  * adjacency lists of stub_list_storage_t. The per-vertex lists are
+  * rebuilt lazily after a shuffle, since most shuffles of the rejection
+  * sampler are rejected on multi-edges, before any inclusion test. Those are only built for
+  * facet_neighbors() and vertex_neighbors(), and dropped on the next
+  * modification. bitset_t is either std::bitset<W>, for complexes on at
+  * most W vertices, or the dynamic boost::dynamic_bitset<>.
+  */
+template <class bitset_t>
+class bitset_storage_t : public stub_list_storage_t {
+public:
+  bitset_storage_t() : facet_stubs_valid_(true) {}
+
+  void init(const uint_vec_t & s, const uint_vec_t & d)
+  {
+    stub_list_storage_t::init(s, d);
+    bitset_t empty;
+    resize_bitset(empty, d.size());
+    bits_.assign(s.size(), empty);
+    vertex_offset_.assign(d.size() + 1, 0);
+    for (id_t v = 0; v < d.size(); ++v)
+      vertex_offset_[v + 1] = vertex_offset_[v] + d[v];
+    facet_stubs_.assign(vertex_offset_.back(), 0);
+    facet_stubs_valid_ = true;
+  }
+
+  // SET
+  void connect(id_t facet, id_t vertex)
+  {
+    invalidate_cache();
+    update_facet_stubs();
+    assert(vertex_offset_[vertex] + degree(vertex) < vertex_offset_[vertex + 1]);
+    facet_stubs_[vertex_offset_[vertex] + degree(vertex)] = facet;
+    stub_list_storage_t::connect(facet, vertex);
+    bits_[facet].set(vertex);
+  }
+  void disconnect(id_t facet, id_t vertex)
+  {
+    invalidate_cache();
+    update_facet_stubs();
+    // move the stub at the end of the live part of the vertex
+    unsigned int begin = vertex_offset_[vertex];
+    unsigned int last = begin + degree(vertex) - 1;
+    unsigned int m = begin;
+    while (m <= last && facet_stubs_[m] != facet) ++m;
+    assert(m <= last);
+    std::swap(facet_stubs_[m], facet_stubs_[last]);
+    stub_list_storage_t::disconnect(facet, vertex);
+    // the bit stays set if the incidence was repeated
+    if (!stub_list_storage_t::contains(facet, vertex)) bits_[facet].reset(vertex);
+  }
+  void disconnect_all()
+  {
+    stub_list_storage_t::disconnect_all();
+    for (auto & b : bits_) b.reset();
+    facet_stubs_valid_ = true;  // all empty
+  }
+  void shuffle(std::mt19937 & engine)
+  {
+    // clear and set the bits of the incidences only, since facets are sparse
+    for_each_incidence([this](id_t f, id_t v) {bits_[f].reset(v);});
+    stub_list_storage_t::shuffle(engine);
+    for_each_incidence([this](id_t f, id_t v) {bits_[f].set(v);});
+    facet_stubs_valid_ = false;
+  }
+
+  // GET
+  bool contains(id_t facet, id_t vertex) const {return bits_[facet].test(vertex);}
+  bool has_multiedge(id_t facet) const {return bits_[facet].count() != size(facet);}
+  // has_multiedges() of the stub lists is O(M) rather than O(F x N).
+  bool included_in(id_t facet_a, id_t facet_b) const
+  {
+    return size(facet_a) <= size(facet_b) && is_subset(bits_[facet_a], bits_[facet_b]);
+  }
+  neighborhood_t all_inclusions_of(id_t facet) const
+  {
+    // candidates are the facets of the vertex of lowest degree
+    id_t pivot = 0;
+    bool first = true;
+    for_each_vertex_of(facet, [&](id_t v) {
+      if (first || degree(v) < degree(pivot)) pivot = v;
+      first = false;
+    });
+    neighborhood_t inclusions;
+    for_each_facet_of(pivot, [&](id_t g) {
+      if (g == facet || inclusions.count(g) > 0) return;
+      if (is_subset(bits_[facet], bits_[g])) inclusions.insert(g);
+    });
+    return inclusions;
+  }
+  /// Call fn(facet) on each facet of a vertex, once per incidence.
+  template <typename function_t>
+  void for_each_facet_of(id_t vertex, function_t fn) const
+  {
+    update_facet_stubs();
+    for (unsigned int m = vertex_offset_[vertex]; m < vertex_offset_[vertex] + degree(vertex); ++m)
+      fn(facet_stubs_[m]);
+  }
+
+private:
+  std::vector<bitset_t> bits_;
+  // facets of vertex v are in [vertex_offset_[v], vertex_offset_[v] + degree(v))
+  uint_vec_t vertex_offset_;
+  mutable uint_vec_t facet_stubs_;
+  // Stale after a shuffle; concurrent readers rebuild them once.
+  mutable std::atomic<bool> facet_stubs_valid_;
+  mutable std::mutex facet_stubs_mutex_;
+  mutable uint_vec_t next_stub_;  // scratch space of update_facet_stubs()
+
+  void update_facet_stubs() const
+  {
+    if (facet_stubs_valid_.load(std::memory_order_acquire)) return;
+    std::lock_guard<std::mutex> lock(facet_stubs_mutex_);
+    if (facet_stubs_valid_.load(std::memory_order_relaxed)) return;
+    next_stub_.assign(vertex_offset_.begin(), vertex_offset_.end() - 1);
+    for_each_incidence([this](id_t f, id_t v) {facet_stubs_[next_stub_[v]++] = f;});
+    facet_stubs_valid_.store(true, std::memory_order_release);
+  }
+};
+
+#endif // SCM_BITSET_IMPL_H
@@ -0,0 +1,46 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Inclusion tests on the neighborhoods of a storage policy
+// Reference: https://doi.org/10.1103/PhysRevE.96.032312
+// arXiv link:  https://arxiv.org/abs/1705.10298
+#ifndef SCM_INCLUSIONS_H
+#define SCM_INCLUSIONS_H
+
+#include <algorithm>
+#include "../types.h"
+
+/// Whether facet_a is included in facet_b, using the sorted facet
+/// neighborhoods of a storage policy.
+template <class storage_t>
+bool neighborhood_included_in(const storage_t & storage, id_t facet_a, id_t facet_b)
+{
+  const neighborhood_t & neighbors_a = storage.facet_neighbors(facet_a);
+  const neighborhood_t & neighbors_b = storage.facet_neighbors(facet_b);
+  return neighbors_a.size() <= neighbors_b.size() &&
+         std::includes(neighbors_b.begin(), neighbors_b.end(), neighbors_a.begin(), neighbors_a.end());
+}
+
+/// All the facets in which a facet is included, using the neighborhoods of
+/// a storage policy.
+template <class storage_t>
+neighborhood_t neighborhood_inclusions_of(const storage_t & storage, id_t facet)
+{
+  // X is included in Y means if the vertices of X
+  // are all connected to a facet Y != X. Candidates are the facets of the
+  // vertex of X of lowest degree, which are then checked one by one.
+  const neighborhood_t & neighbors = storage.facet_neighbors(facet);
+  id_t pivot = *neighbors.begin();
+  for (id_t v : neighbors)
+    if (storage.degree(v) < storage.degree(pivot)) pivot = v;
+  neighborhood_t inclusions;
+  for (id_t g : storage.vertex_neighbors(pivot))
+  {
+    if (g == facet || (!inclusions.empty() && *inclusions.rbegin() == g)) continue;
+    bool included = true;
+    for (auto v = neighbors.begin(); included && v != neighbors.end(); ++v)
+      included = *v == pivot || storage.contains(g, *v);
+    if (included) inclusions.insert(g);
+  }
+  return inclusions;
+}
+
+#endif // SCM_INCLUSIONS_H
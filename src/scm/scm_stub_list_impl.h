@@ -0,0 +1,217 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Stub list storage policy for the simplicial configuration model
+// Reference: https://doi.org/10.1103/PhysRevE.96.032312
+// arXiv link:  https://arxiv.org/abs/1705.10298
+#ifndef SCM_STUB_LIST_IMPL_H
+#define SCM_STUB_LIST_IMPL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <random>
+#include <vector>
+#include "../types.h"
+#include "scm_inclusions.h"
+
+
+/** @class stub_list_storage_t
+  * @brief Stores states explicitly as two aligned lists of stubs.
+  *
+  * Stub m joins vertex vertex_stubs_[m] to facet facet_of_stub_[m]. The
+  * stubs of a facet are contiguous and their number is fixed by the size
+  * sequence, so that the facet list never moves: a shuffle is an in-place
+  * permutation of vertex_stubs_, a rewiring move is a swap of stub entries,
+  * and uniformly random incidences are drawn in O(1).
+  *
+  * Adjacency lists are materialized on demand. They are rebuilt lazily after
+  * a shuffle, and updated incrementally by connect() and disconnect()
+  * otherwise. Rejection-heavy workloads avoid them altogether: multi-edges
+  * are detected on the stubs directly.
+  */
+class stub_list_storage_t {
+public:
+  stub_list_storage_t() : M_(0), stamp_(0), cache_valid_(false) {}
+
+  /// Empty state with F = s.size() facets and N = d.size() vertices.
+  void init(const uint_vec_t & s, const uint_vec_t & d)
+  {
+    offset_.assign(s.size() + 1, 0);
+    for (id_t f = 0; f < s.size(); ++f)
+      offset_[f + 1] = offset_[f] + s[f];
+    M_ = offset_.back();
+    facet_of_stub_.resize(M_);
+    for (id_t f = 0; f < s.size(); ++f)
+      std::fill(facet_of_stub_.begin() + offset_[f], facet_of_stub_.begin() + offset_[f + 1], f);
+    vertex_stubs_.assign(M_, 0);
+    size_.assign(s.size(), 0);
+    degree_.assign(d.size(), 0);
+    last_seen_.assign(d.size(), 0);
+    stamp_ = 0;
+    invalidate_cache();
+  }
+
+  // SET
+  void connect(id_t facet, id_t vertex)
+  {
+    assert(offset_[facet] + size_[facet] < offset_[facet + 1]);
+    vertex_stubs_[offset_[facet] + size_[facet]] = vertex;
+    ++size_[facet];
+    ++degree_[vertex];
+    if (cache_valid_)
+    {
+      facet_cache_[facet].insert(vertex);
+      vertex_cache_[vertex].insert(facet);
+    }
+  }
+  void disconnect(id_t facet, id_t vertex)
+  {
+    // move the stub at the end of the live part of the facet
+    unsigned int begin = offset_[facet];
+    unsigned int last = begin + size_[facet] - 1;
+    unsigned int m = begin;
+    while (m <= last && vertex_stubs_[m] != vertex) ++m;
+    assert(m <= last);
+    std::swap(vertex_stubs_[m], vertex_stubs_[last]);
+    --size_[facet];
+    --degree_[vertex];
+    if (cache_valid_)
+    {
+      facet_cache_[facet].erase(facet_cache_[facet].find(vertex));
+      vertex_cache_[vertex].erase(vertex_cache_[vertex].find(facet));
+    }
+  }
+  void disconnect_all()
+  {
+    std::fill(size_.begin(), size_.end(), 0);
+    std::fill(degree_.begin(), degree_.end(), 0);
+    invalidate_cache();
+  }
+  /// Random matching with the same sizes and degrees.
+  void shuffle(std::mt19937 & engine)
+  {
+    // only valid on complete states, where every stub is live
+    for (id_t f = 0; f < size_.size(); ++f)
+      assert(size_[f] == offset_[f + 1] - offset_[f]);
+    std::shuffle(vertex_stubs_.begin(), vertex_stubs_.end(), engine);
+    invalidate_cache();
+  }
+
+  // GET
+  const neighborhood_t & facet_neighbors(id_t facet) const
+  {
+    update_cache();
+    return facet_cache_[facet];
+  }
+  const neighborhood_t & vertex_neighbors(id_t vertex) const
+  {
+    update_cache();
+    return vertex_cache_[vertex];
+  }
+  unsigned int size(id_t facet) const {return size_[facet];}
+  unsigned int degree(id_t vertex) const {return degree_[vertex];}
+  bool contains(id_t facet, id_t vertex) const
+  {
+    auto begin = vertex_stubs_.begin() + offset_[facet];
+    return std::find(begin, begin + size_[facet], vertex) != begin + size_[facet];
+  }
+  bool has_multiedge(id_t facet) const
+  {
+    std::vector<id_t> stubs(vertex_stubs_.begin() + offset_[facet],
+                            vertex_stubs_.begin() + offset_[facet] + size_[facet]);
+    std::sort(stubs.begin(), stubs.end());
+    return std::adjacent_find(stubs.begin(), stubs.end()) != stubs.end();
+  }
+  bool has_multiedges() const
+  {
+    // single pass over the stubs, marking vertices with a per-call stamp
+    // (not thread-safe; use has_multiedge() concurrently).
+    for (id_t f = 0; f + 1 < offset_.size(); ++f)
+    {
+      if (++stamp_ == 0)
+      {
+        std::fill(last_seen_.begin(), last_seen_.end(), 0);
+        stamp_ = 1;
+      }
+      for (unsigned int m = offset_[f]; m < offset_[f] + size_[f]; ++m)
+      {
+        if (last_seen_[vertex_stubs_[m]] == stamp_) return true;
+        last_seen_[vertex_stubs_[m]] = stamp_;
+      }
+    }
+    return false;
+  }
+  bool included_in(id_t facet_a, id_t facet_b) const {return neighborhood_included_in(*this, facet_a, facet_b);}
+  neighborhood_t all_inclusions_of(id_t facet) const {return neighborhood_inclusions_of(*this, facet);}
+  /// Call fn(facet) on each facet of a vertex, once per incidence.
+  template <typename function_t>
+  void for_each_facet_of(id_t vertex, function_t fn) const
+  {
+    for (id_t f : vertex_neighbors(vertex)) fn(f);
+  }
+  /// Call fn(vertex) on each vertex of a facet, once per incidence.
+  template <typename function_t>
+  void for_each_vertex_of(id_t facet, function_t fn) const
+  {
+    for (unsigned int m = offset_[facet]; m < offset_[facet] + size_[facet]; ++m)
+      fn(vertex_stubs_[m]);
+  }
+  /// Call fn(facet, vertex) on each incidence.
+  template <typename function_t>
+  void for_each_incidence(function_t fn) const
+  {
+    for (id_t f = 0; f + 1 < offset_.size(); ++f)
+      for (unsigned int m = offset_[f]; m < offset_[f] + size_[f]; ++m)
+        fn(f, vertex_stubs_[m]);
+  }
+  /// Uniformly random incidence, as (vertex, facet).
+  edge_t random_incidence(std::mt19937 & engine)
+  {
+    std::uniform_int_distribution<unsigned int> rand_stub(0, M_ - 1);
+    unsigned int m = rand_stub(engine);
+    return edge_t(vertex_stubs_[m], facet_of_stub_[m]);
+  }
+
+private:
+  // Stubs
+  uint_vec_t offset_;         // stubs of facet f are in [offset_[f], offset_[f + 1])
+  uint_vec_t facet_of_stub_;
+  uint_vec_t vertex_stubs_;
+  uint_vec_t size_;           // live stubs of each facet
+  uint_vec_t degree_;
+  unsigned int M_;
+  // Scratch space of has_multiedges()
+  mutable uint_vec_t last_seen_;
+  mutable unsigned int stamp_;
+  // Materialized adjacency lists; concurrent readers rebuild them once.
+  mutable adj_list_t facet_cache_;
+  mutable adj_list_t vertex_cache_;
+  mutable std::atomic<bool> cache_valid_;
+  mutable std::mutex cache_mutex_;
+
+protected:
+  /// Drop the adjacency lists, which are rebuilt on the next access.
+  void invalidate_cache()
+  {
+    cache_valid_ = false;
+    facet_cache_.clear();
+    vertex_cache_.clear();
+  }
+
+private:
+  void update_cache() const
+  {
+    if (cache_valid_.load(std::memory_order_acquire)) return;
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    if (cache_valid_.load(std::memory_order_relaxed)) return;
+    facet_cache_.assign(size_.size(), neighborhood_t());
+    vertex_cache_.assign(degree_.size(), neighborhood_t());
+    for_each_incidence([this](id_t f, id_t v) {
+      facet_cache_[f].insert(v);
+      vertex_cache_[v].insert(f);
+    });
+    cache_valid_.store(true, std::memory_order_release);
+  }
+};
+
+#endif // SCM_STUB_LIST_IMPL_H
@@ -0,0 +1,93 @@
+// Author: Jean-Gabriel Young <info@jgyoung.ca>
+// Minimal fixed-size thread pool with a bounded task queue.
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+#ifndef THREAD_POOL
+#define THREAD_POOL
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+
+/** @class thread_pool_t
+  * @brief Runs tasks on a fixed number of threads.
+  *
+  * submit() blocks while max_pending tasks are queued, such that a fast
+  * producer (e.g., the MCMC chain) cannot accumulate unbounded work.
+  */
+class thread_pool_t {
+public:
+  thread_pool_t(unsigned int num_threads, unsigned int max_pending)
+    : max_pending_(max_pending > 0 ? max_pending : 1), running_(0), stop_(false)
+  {
+    if (num_threads == 0) num_threads = 1;
+    for (unsigned int t = 0; t < num_threads; ++t)
+      threads_.push_back(std::thread(&thread_pool_t::work, this));
+  }
+
+  ~thread_pool_t()
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    task_available_.notify_all();
+    for (auto & th : threads_) th.join();
+  }
+
+  void submit(std::function<void()> task)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    slot_available_.wait(lock, [this]() {return tasks_.size() < max_pending_;});
+    tasks_.push(task);
+    task_available_.notify_one();
+  }
+
+  /// Block until all submitted tasks are done.
+  void wait()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this]() {return tasks_.empty() && running_ == 0;});
+  }
+
+  unsigned int size() const {return threads_.size();}
+
+private:
+  std::vector<std::thread> threads_;
+  std::queue< std::function<void()> > tasks_;
+  std::mutex mutex_;
+  std::condition_variable task_available_;
+  std::condition_variable slot_available_;
+  std::condition_variable idle_;
+  unsigned int max_pending_;
+  unsigned int running_;
+  bool stop_;
+
+  void work()
+  {
+    while (true)
+    {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        task_available_.wait(lock, [this]() {return stop_ || !tasks_.empty();});
+        if (tasks_.empty()) return;  // stopping
+        task = tasks_.front();
+        tasks_.pop();
+        ++running_;
+      }
+      slot_available_.notify_one();
+      task();
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        --running_;
+        if (tasks_.empty() && running_ == 0) idle_.notify_all();
+      }
+    }
+  }
+};
+
+#endif
@@ -1,12 +1,25 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#include <cstdint>
 #include <map>
+#include <string>
+#include <sys/types.h>  // id_t
 #include <vector>
 #include <set>
 #include <utility>
+#include "label_table.h"
 
 
+typedef std::uint64_t hash_t;
+/// splitmix64 finalizer: a cheap bijective mix of the bits of x.
+inline hash_t mix_hash(hash_t x)
+{
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
 typedef std::pair<id_t, id_t> edge_t;
 typedef std::vector<edge_t> edge_list_t;
 typedef std::multiset<id_t> neighborhood_t;
@@ -26,5 +39,5 @@ typedef std::vector<float> float_vec_t;
 typedef std::vector< std::vector<unsigned int> > uint_mat_t;
 typedef std::vector< std::vector<int> > int_mat_t;
 typedef std::vector< std::vector<float> > float_mat_t;
-typedef std::map<id_t, std::string> vmap_t;
+typedef label_table_t vmap_t;
 #endif // TYPES_H